@@ -0,0 +1,1323 @@
+// Narzędzie offline: przygotowanie tekstur z katalogu asserts do skompresowanych formatów GPU.
+// Budowanie natywne (bez Emscripten):
+//   g++ -O2 -std=c++17 -pthread bake.cpp -o bake
+//   ./bake asserts [--atlas] [--array] [--manifest]
+//   ./bake --selftest   - koder każdego formatu sprawdzany niezależnym dekoderem bloków
+// Dla każdego PNG powstają pliki obok oryginału, każdy z pełnym łańcuchem mipmap:
+//   Nazwa.astc.ktx  - ASTC 4x4 (mobilne GPU, nowe przeglądarki)
+//   Nazwa.etc2.ktx  - ETC2 RGB8 / ETC2 RGBA8 (EAC) (GLES3, WebGL2 na Androidzie)
+//   Nazwa.etc1.ktx  - ETC1 (stare GLES2, tylko tekstury bez alfy)
+//   Nazwa.bc.ktx    - BC1 / BC3 (S3TC, przeglądarki desktopowe)
+//   Nazwa.rgba.ktx  - nieskompresowane RGBA8, gdy GPU nie zna żadnego z powyższych
+// Z --atlas dodatkowo powstają strony atlasu (tylko atlas0.*.ktx ..., bez PNG) i opis prostokątów atlas.txt.
+// Z --array powstają warstwy tablicy tekstur (backend GLES3): Nazwa.array.*.ktx, wszystkie
+// w jednym kwadratowym rozmiarze potęgi dwójki i w formacie z alfą (bez ETC1 i bez tekstur blend).
+// Z --manifest na końcu powstaje manifest.txt: każdy plik katalogu (rekurencyjnie) z rozmiarem
+// i skrótem FNV-1a treści; pliki o tej samej treści wskazują pierwszy z nich. cc.cpp pobiera
+// według niego tylko to, czego potrzebuje, a skrót służy jako klucz pamięci podręcznej.
+// Program w cc.cpp wybiera w czasie działania najlepszy format obsługiwany przez GPU,
+// a gdy nie ma żadnego pliku .ktx - ładuje zwykły PNG i generuje mipmapy sam.
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+#include <map>
+#include <iomanip>
+#include <random>
+
+namespace fs = std::filesystem;
+
+// Stałe GL zapisywane w nagłówku KTX (bez dołączania nagłówków GL)
+const uint32_t GL_UNSIGNED_BYTE_ = 0x1401;
+const uint32_t GL_RGB_ = 0x1907;
+const uint32_t GL_RGBA_ = 0x1908;
+const uint32_t GL_COMPRESSED_RGB_S3TC_DXT1 = 0x83F0;
+const uint32_t GL_COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3;
+const uint32_t GL_ETC1_RGB8 = 0x8D64;
+const uint32_t GL_COMPRESSED_RGB8_ETC2 = 0x9274;
+const uint32_t GL_COMPRESSED_RGBA8_ETC2_EAC = 0x9278;
+const uint32_t GL_COMPRESSED_RGBA_ASTC_4x4 = 0x93B0;
+
+// --- Obraz i klasyfikacja alfy ---
+struct Image {
+    int w = 0, h = 0;
+    std::vector<uint8_t> rgba; // zawsze 4 kanały
+};
+
+// Te same progi co classifyAlpha() w cc.cpp
+const char* classifyAlpha(const Image& img) {
+    size_t transparent = 0, partial = 0;
+    size_t total = (size_t)img.w * img.h;
+    for (size_t i = 0; i < total; ++i) {
+        uint8_t a = img.rgba[i * 4 + 3];
+        if (a < 8) {
+            ++transparent;
+        } else if (a < 248) {
+            ++partial;
+        }
+    }
+    if (transparent == 0 && partial == 0) return "opaque";
+    if (partial * 20 < total) return "mask";
+    return "blend";
+}
+
+// --- Łańcuch mipmap ---
+// Filtrowanie w przestrzeni liniowej; alfa jest liniowa z definicji
+float srgbToLinearTable[256];
+
+void initSrgbTable() {
+    for (int i = 0; i < 256; ++i) {
+        float c = i / 255.0f;
+        srgbToLinearTable[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+}
+
+uint8_t linearToSrgb(float c) {
+    c = std::clamp(c, 0.0f, 1.0f);
+    float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    return (uint8_t)std::lround(s * 255.0f);
+}
+
+bool isPowerOfTwo(int v) {
+    return v > 0 && (v & (v - 1)) == 0;
+}
+
+Image downsample(const Image& src);
+
+// Przeskalowanie dwuliniowe; przy dużym zmniejszeniu najpierw schodzimy filtrem mipmap,
+// żeby interpolacja nie gubiła pikseli
+Image resizeTo(const Image& original, int width, int height) {
+    Image reduced;
+    const Image* srcPtr = &original;
+    while (srcPtr->w >= width * 2 && srcPtr->h >= height * 2) {
+        reduced = downsample(*srcPtr);
+        srcPtr = &reduced;
+    }
+    const Image& src = *srcPtr;
+
+    Image dst;
+    dst.w = width;
+    dst.h = height;
+    dst.rgba.resize((size_t)dst.w * dst.h * 4);
+
+    for (int y = 0; y < dst.h; ++y) {
+        float fy = std::max(0.0f, (y + 0.5f) * src.h / dst.h - 0.5f);
+        int y0 = std::min((int)fy, src.h - 1), y1 = std::min(y0 + 1, src.h - 1);
+        float ty = fy - y0;
+        for (int x = 0; x < dst.w; ++x) {
+            float fx = std::max(0.0f, (x + 0.5f) * src.w / dst.w - 0.5f);
+            int x0 = std::min((int)fx, src.w - 1), x1 = std::min(x0 + 1, src.w - 1);
+            float tx = fx - x0;
+            const uint8_t* p00 = &src.rgba[((size_t)y0 * src.w + x0) * 4];
+            const uint8_t* p10 = &src.rgba[((size_t)y0 * src.w + x1) * 4];
+            const uint8_t* p01 = &src.rgba[((size_t)y1 * src.w + x0) * 4];
+            const uint8_t* p11 = &src.rgba[((size_t)y1 * src.w + x1) * 4];
+            uint8_t* out = &dst.rgba[((size_t)y * dst.w + x) * 4];
+            for (int c = 0; c < 4; ++c) {
+                auto lin = [&](const uint8_t* p) { return c < 3 ? srgbToLinearTable[p[c]] : p[c] / 255.0f; };
+                float v = (lin(p00) * (1 - tx) + lin(p10) * tx) * (1 - ty) + (lin(p01) * (1 - tx) + lin(p11) * tx) * ty;
+                out[c] = c < 3 ? linearToSrgb(v) : (uint8_t)std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f);
+            }
+        }
+    }
+    return dst;
+}
+
+// WebGL1 nie pozwala na mipmapy tekstur NPOT - przeskalowanie w górę do potęgi dwójki
+Image resizeToPowerOfTwo(const Image& src) {
+    int w = 1, h = 1;
+    while (w < src.w) w <<= 1;
+    while (h < src.h) h <<= 1;
+    return resizeTo(src, w, h);
+}
+
+// Zmniejszenie 2x filtrem [1 3 3 1]/8 w obu osiach (mniej aliasingu niż średnia 2x2)
+Image downsample(const Image& src) {
+    Image dst;
+    dst.w = std::max(1, src.w / 2);
+    dst.h = std::max(1, src.h / 2);
+    dst.rgba.resize((size_t)dst.w * dst.h * 4);
+
+    const float weights[4] = {1.0f / 8, 3.0f / 8, 3.0f / 8, 1.0f / 8};
+    auto tap = [](int center, int k, int size, int dstSize) {
+        if (dstSize == size) return center; // wymiar już równy 1
+        return std::clamp(center * 2 - 1 + k, 0, size - 1);
+    };
+
+    for (int y = 0; y < dst.h; ++y) {
+        for (int x = 0; x < dst.w; ++x) {
+            float acc[4] = {0, 0, 0, 0};
+            for (int ky = 0; ky < 4; ++ky) {
+                int sy = tap(y, ky, src.h, dst.h);
+                for (int kx = 0; kx < 4; ++kx) {
+                    int sx = tap(x, kx, src.w, dst.w);
+                    float w = weights[kx] * weights[ky];
+                    const uint8_t* p = &src.rgba[((size_t)sy * src.w + sx) * 4];
+                    acc[0] += w * srgbToLinearTable[p[0]];
+                    acc[1] += w * srgbToLinearTable[p[1]];
+                    acc[2] += w * srgbToLinearTable[p[2]];
+                    acc[3] += w * p[3] / 255.0f;
+                }
+            }
+            uint8_t* out = &dst.rgba[((size_t)y * dst.w + x) * 4];
+            out[0] = linearToSrgb(acc[0]);
+            out[1] = linearToSrgb(acc[1]);
+            out[2] = linearToSrgb(acc[2]);
+            out[3] = (uint8_t)std::lround(std::clamp(acc[3], 0.0f, 1.0f) * 255.0f);
+        }
+    }
+    return dst;
+}
+
+// Średnia 2x2 - w atlasie komórki leżą na wielokrotnościach swojego rozmiaru (potęgi dwójki),
+// więc taki filtr nigdy nie miesza sąsiednich tekstur
+Image downsampleBox(const Image& src) {
+    Image dst;
+    dst.w = std::max(1, src.w / 2);
+    dst.h = std::max(1, src.h / 2);
+    dst.rgba.resize((size_t)dst.w * dst.h * 4);
+
+    for (int y = 0; y < dst.h; ++y) {
+        for (int x = 0; x < dst.w; ++x) {
+            float acc[4] = {0, 0, 0, 0};
+            for (int k = 0; k < 4; ++k) {
+                int sx = std::min(x * 2 + (k & 1), src.w - 1);
+                int sy = std::min(y * 2 + (k >> 1), src.h - 1);
+                const uint8_t* p = &src.rgba[((size_t)sy * src.w + sx) * 4];
+                acc[0] += srgbToLinearTable[p[0]] * 0.25f;
+                acc[1] += srgbToLinearTable[p[1]] * 0.25f;
+                acc[2] += srgbToLinearTable[p[2]] * 0.25f;
+                acc[3] += p[3] / 255.0f * 0.25f;
+            }
+            uint8_t* out = &dst.rgba[((size_t)y * dst.w + x) * 4];
+            out[0] = linearToSrgb(acc[0]);
+            out[1] = linearToSrgb(acc[1]);
+            out[2] = linearToSrgb(acc[2]);
+            out[3] = (uint8_t)std::lround(std::clamp(acc[3], 0.0f, 1.0f) * 255.0f);
+        }
+    }
+    return dst;
+}
+
+// Ułamek pikseli, które przejdą alpha-test (próg 0.5 jak w shaderze) po przeskalowaniu alfy
+float alphaCoverage(const Image& img, float scale) {
+    size_t covered = 0, total = (size_t)img.w * img.h;
+    for (size_t i = 0; i < total; ++i) {
+        if (img.rgba[i * 4 + 3] * scale >= 127.5f) ++covered;
+    }
+    return (float)covered / total;
+}
+
+// Bez korekty włosy i rzęsy z alpha-testem "łysieją" na mniejszych mipach,
+// bo uśrednianie obniża alfę poniżej progu. Szukamy skali alfy dającej pokrycie z mip 0.
+void preserveAlphaCoverage(Image& mip, float targetCoverage) {
+    float lo = 0.0f, hi = 4.0f;
+    for (int it = 0; it < 12; ++it) {
+        float mid = (lo + hi) * 0.5f;
+        if (alphaCoverage(mip, mid) < targetCoverage) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    float scale = (lo + hi) * 0.5f;
+    size_t total = (size_t)mip.w * mip.h;
+    for (size_t i = 0; i < total; ++i) {
+        mip.rgba[i * 4 + 3] = (uint8_t)std::min(255.0f, std::round(mip.rgba[i * 4 + 3] * scale));
+    }
+}
+
+std::vector<Image> buildMipChain(const Image& base, bool keepCoverage, bool boxFilter = false) {
+    std::vector<Image> chain;
+    chain.push_back(isPowerOfTwo(base.w) && isPowerOfTwo(base.h) ? base : resizeToPowerOfTwo(base));
+
+    float coverage = keepCoverage ? alphaCoverage(chain[0], 1.0f) : 0.0f;
+    while (chain.back().w > 1 || chain.back().h > 1) {
+        Image next = boxFilter ? downsampleBox(chain.back()) : downsample(chain.back());
+        if (keepCoverage) {
+            preserveAlphaCoverage(next, coverage);
+        }
+        chain.push_back(std::move(next));
+    }
+    return chain;
+}
+
+// Blok 4x4 pikseli (wiersz po wierszu), na krawędziach powielany ostatni piksel
+void fetchBlock(const Image& img, int bx, int by, uint8_t px[16][4]) {
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            int sx = std::min(bx * 4 + x, img.w - 1);
+            int sy = std::min(by * 4 + y, img.h - 1);
+            memcpy(px[y * 4 + x], &img.rgba[((size_t)sy * img.w + sx) * 4], 4);
+        }
+    }
+}
+
+int colorDistSq(const int* a, const uint8_t* b) {
+    int dr = a[0] - b[0], dg = a[1] - b[1], db = a[2] - b[2];
+    return dr * dr + dg * dg + db * db;
+}
+
+// Skrajne kolory bloku wzdłuż głównej osi rozrzutu (kilka iteracji metody potęgowej)
+void principalEndpoints(const uint8_t px[16][4], int lo[3], int hi[3]) {
+    float mean[3] = {0, 0, 0};
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 3; ++c) mean[c] += px[i][c] / 16.0f;
+    }
+    float cov[6] = {0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < 16; ++i) {
+        float d[3] = {px[i][0] - mean[0], px[i][1] - mean[1], px[i][2] - mean[2]};
+        cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+        cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+    }
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int it = 0; it < 4; ++it) {
+        float n[3] = {
+            cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+            cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+            cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]};
+        float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len < 1e-6f) break;
+        for (int c = 0; c < 3; ++c) axis[c] = n[c] / len;
+    }
+
+    float minProj = 1e30f, maxProj = -1e30f;
+    int minIdx = 0, maxIdx = 0;
+    for (int i = 0; i < 16; ++i) {
+        float p = px[i][0] * axis[0] + px[i][1] * axis[1] + px[i][2] * axis[2];
+        if (p < minProj) { minProj = p; minIdx = i; }
+        if (p > maxProj) { maxProj = p; maxIdx = i; }
+    }
+    // Lekkie wcięcie końców do środka zmniejsza średni błąd
+    for (int c = 0; c < 3; ++c) {
+        int inset = (px[maxIdx][c] - px[minIdx][c]) / 16;
+        lo[c] = std::clamp(px[minIdx][c] + inset, 0, 255);
+        hi[c] = std::clamp(px[maxIdx][c] - inset, 0, 255);
+    }
+}
+
+// --- BC1 / BC3 (S3TC) ---
+uint16_t packRgb565(const int c[3]) {
+    return (uint16_t)(((c[0] * 31 + 127) / 255) << 11 | ((c[1] * 63 + 127) / 255) << 5 | ((c[2] * 31 + 127) / 255));
+}
+
+void unpackRgb565(uint16_t v, int out[3]) {
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+void encodeBC1Block(const uint8_t px[16][4], uint8_t out[8]) {
+    int lo[3], hi[3];
+    principalEndpoints(px, lo, hi);
+    uint16_t c0 = packRgb565(hi), c1 = packRgb565(lo);
+    if (c0 < c1) std::swap(c0, c1);
+
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        int pal[4][3];
+        unpackRgb565(c0, pal[0]);
+        unpackRgb565(c1, pal[1]);
+        for (int c = 0; c < 3; ++c) {
+            pal[2][c] = (2 * pal[0][c] + pal[1][c]) / 3;
+            pal[3][c] = (pal[0][c] + 2 * pal[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, bestErr = colorDistSq(pal[0], px[i]);
+            for (int k = 1; k < 4; ++k) {
+                int err = colorDistSq(pal[k], px[i]);
+                if (err < bestErr) { bestErr = err; best = k; }
+            }
+            indices |= (uint32_t)best << (2 * i);
+        }
+    }
+
+    out[0] = c0 & 0xFF; out[1] = c0 >> 8;
+    out[2] = c1 & 0xFF; out[3] = c1 >> 8;
+    for (int i = 0; i < 4; ++i) out[4 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+void encodeBC3AlphaBlock(const uint8_t px[16][4], uint8_t out[8]) {
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; ++i) {
+        a0 = std::max(a0, (int)px[i][3]);
+        a1 = std::min(a1, (int)px[i][3]);
+    }
+
+    uint64_t indices = 0;
+    if (a0 != a1) {
+        int pal[8] = {a0, a1};
+        for (int k = 2; k < 8; ++k) pal[k] = ((8 - k) * a0 + (k - 1) * a1) / 7;
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, bestErr = 1 << 30;
+            for (int k = 0; k < 8; ++k) {
+                int err = std::abs(pal[k] - px[i][3]);
+                if (err < bestErr) { bestErr = err; best = k; }
+            }
+            indices |= (uint64_t)best << (3 * i);
+        }
+    }
+
+    out[0] = (uint8_t)a0;
+    out[1] = (uint8_t)a1;
+    for (int i = 0; i < 6; ++i) out[2 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+// --- ETC1 / ETC2 / EAC ---
+const int etcModifiers[8][4] = {
+    {2, 8, -2, -8}, {5, 17, -5, -17}, {9, 29, -9, -29}, {13, 42, -13, -42},
+    {18, 60, -18, -60}, {24, 80, -24, -80}, {33, 106, -33, -106}, {47, 183, -47, -183}};
+
+// Najlepsza tablica modyfikatorów dla podbloku o danym kolorze bazowym
+int bestEtcTable(const uint8_t px[16][4], const int* members, const int base[3], int& tableOut) {
+    int bestErr = 1 << 30;
+    for (int t = 0; t < 8; ++t) {
+        int err = 0;
+        for (int m = 0; m < 8; ++m) {
+            const uint8_t* p = px[members[m]];
+            int pixelBest = 1 << 30;
+            for (int k = 0; k < 4; ++k) {
+                int c[3];
+                for (int ch = 0; ch < 3; ++ch) c[ch] = std::clamp(base[ch] + etcModifiers[t][k], 0, 255);
+                pixelBest = std::min(pixelBest, colorDistSq(c, p));
+            }
+            err += pixelBest;
+        }
+        if (err < bestErr) { bestErr = err; tableOut = t; }
+    }
+    return bestErr;
+}
+
+// Blok ETC1 bez przepełnienia w trybie różnicowym - jednocześnie poprawny blok ETC2 RGB8
+void encodeETC1Block(const uint8_t px[16][4], uint8_t out[8]) {
+    uint64_t bestWord = 0;
+    int bestErr = 1 << 30;
+
+    for (int flip = 0; flip < 2; ++flip) {
+        // Piksele podbloków: flip=0 lewa/prawa połowa, flip=1 górna/dolna
+        int members[2][8];
+        int count[2] = {0, 0};
+        for (int y = 0; y < 4; ++y) {
+            for (int x = 0; x < 4; ++x) {
+                int sub = flip ? (y >= 2) : (x >= 2);
+                members[sub][count[sub]++] = y * 4 + x;
+            }
+        }
+
+        float avg[2][3] = {{0, 0, 0}, {0, 0, 0}};
+        for (int s = 0; s < 2; ++s) {
+            for (int m = 0; m < 8; ++m) {
+                for (int c = 0; c < 3; ++c) avg[s][c] += px[members[s][m]][c] / 8.0f;
+            }
+        }
+
+        int q5[2][3], q4[2][3];
+        bool diffFits = true;
+        for (int s = 0; s < 2; ++s) {
+            for (int c = 0; c < 3; ++c) {
+                q5[s][c] = std::clamp((int)std::lround(avg[s][c] * 31.0f / 255.0f), 0, 31);
+                q4[s][c] = std::clamp((int)std::lround(avg[s][c] * 15.0f / 255.0f), 0, 15);
+            }
+        }
+        for (int c = 0; c < 3; ++c) {
+            int d = q5[1][c] - q5[0][c];
+            if (d < -4 || d > 3) diffFits = false;
+        }
+
+        for (int diff = 0; diff < 2; ++diff) {
+            if (diff && !diffFits) continue;
+
+            int base[2][3];
+            for (int s = 0; s < 2; ++s) {
+                for (int c = 0; c < 3; ++c) {
+                    base[s][c] = diff ? ((q5[s][c] << 3) | (q5[s][c] >> 2)) : ((q4[s][c] << 4) | q4[s][c]);
+                }
+            }
+
+            int table[2] = {0, 0};
+            int err = bestEtcTable(px, members[0], base[0], table[0]) + bestEtcTable(px, members[1], base[1], table[1]);
+            if (err >= bestErr) continue;
+            bestErr = err;
+
+            uint64_t word = 0;
+            if (diff) {
+                word |= (uint64_t)q5[0][0] << 59 | (uint64_t)((q5[1][0] - q5[0][0]) & 7) << 56;
+                word |= (uint64_t)q5[0][1] << 51 | (uint64_t)((q5[1][1] - q5[0][1]) & 7) << 48;
+                word |= (uint64_t)q5[0][2] << 43 | (uint64_t)((q5[1][2] - q5[0][2]) & 7) << 40;
+            } else {
+                word |= (uint64_t)q4[0][0] << 60 | (uint64_t)q4[1][0] << 56;
+                word |= (uint64_t)q4[0][1] << 52 | (uint64_t)q4[1][1] << 48;
+                word |= (uint64_t)q4[0][2] << 44 | (uint64_t)q4[1][2] << 40;
+            }
+            word |= (uint64_t)table[0] << 37 | (uint64_t)table[1] << 34 | (uint64_t)diff << 33 | (uint64_t)flip << 32;
+
+            for (int s = 0; s < 2; ++s) {
+                for (int m = 0; m < 8; ++m) {
+                    int i = members[s][m];
+                    int best = 0, bestPixelErr = 1 << 30;
+                    for (int k = 0; k < 4; ++k) {
+                        int c[3];
+                        for (int ch = 0; ch < 3; ++ch) c[ch] = std::clamp(base[s][ch] + etcModifiers[table[s]][k], 0, 255);
+                        int e = colorDistSq(c, px[i]);
+                        if (e < bestPixelErr) { bestPixelErr = e; best = k; }
+                    }
+                    // Indeksy pikseli w ETC są ułożone kolumnami
+                    int bit = (i % 4) * 4 + (i / 4);
+                    word |= (uint64_t)(best >> 1) << (16 + bit) | (uint64_t)(best & 1) << bit;
+                }
+            }
+            bestWord = word;
+        }
+    }
+
+    for (int i = 0; i < 8; ++i) out[i] = (bestWord >> (56 - 8 * i)) & 0xFF;
+}
+
+const int eacModifiers[16][8] = {
+    {-3, -6, -9, -15, 2, 5, 8, 14}, {-3, -7, -10, -13, 2, 6, 9, 12}, {-2, -5, -8, -13, 1, 4, 7, 12},
+    {-2, -4, -6, -13, 1, 3, 5, 12}, {-3, -6, -8, -12, 2, 5, 7, 11}, {-3, -7, -9, -11, 2, 6, 8, 10},
+    {-4, -7, -8, -11, 3, 6, 7, 10}, {-3, -5, -8, -11, 2, 4, 7, 10}, {-2, -6, -8, -10, 1, 5, 7, 9},
+    {-2, -5, -8, -10, 1, 4, 7, 9}, {-2, -4, -8, -10, 1, 3, 7, 9}, {-2, -5, -7, -10, 1, 4, 6, 9},
+    {-3, -4, -7, -10, 2, 3, 6, 9}, {-1, -2, -3, -10, 0, 1, 2, 9}, {-4, -6, -8, -9, 3, 5, 7, 8},
+    {-3, -5, -7, -9, 2, 4, 6, 8}};
+
+void encodeEACAlphaBlock(const uint8_t px[16][4], uint8_t out[8]) {
+    int amin = 255, amax = 0;
+    for (int i = 0; i < 16; ++i) {
+        amin = std::min(amin, (int)px[i][3]);
+        amax = std::max(amax, (int)px[i][3]);
+    }
+
+    // Stała alfa: tablica 13 ma modyfikator 0 pod indeksem 4
+    int bestBase = amin, bestMul = 1, bestTable = 13;
+    if (amin != amax) {
+        int bestErr = 1 << 30;
+        for (int t = 0; t < 16; ++t) {
+            int span = eacModifiers[t][7] - eacModifiers[t][3];
+            int mulGuess = std::clamp((amax - amin + span / 2) / span, 1, 15);
+            for (int mul = std::max(1, mulGuess - 1); mul <= std::min(15, mulGuess + 1); ++mul) {
+                int base = std::clamp(amin - eacModifiers[t][3] * mul, 0, 255);
+                int err = 0;
+                for (int i = 0; i < 16 && err < bestErr; ++i) {
+                    int pixelBest = 1 << 30;
+                    for (int k = 0; k < 8; ++k) {
+                        int a = std::clamp(base + eacModifiers[t][k] * mul, 0, 255);
+                        pixelBest = std::min(pixelBest, (a - px[i][3]) * (a - px[i][3]));
+                    }
+                    err += pixelBest;
+                }
+                if (err < bestErr) { bestErr = err; bestBase = base; bestMul = mul; bestTable = t; }
+            }
+        }
+    }
+
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; ++i) {
+        int best = 0, bestErr = 1 << 30;
+        for (int k = 0; k < 8; ++k) {
+            int a = std::clamp(bestBase + eacModifiers[bestTable][k] * bestMul, 0, 255);
+            int e = std::abs(a - px[i][3]);
+            if (e < bestErr) { bestErr = e; best = k; }
+        }
+        int p = (i % 4) * 4 + (i / 4);
+        bits |= (uint64_t)best << (45 - 3 * p);
+    }
+
+    out[0] = (uint8_t)bestBase;
+    out[1] = (uint8_t)(bestMul << 4 | bestTable);
+    for (int i = 0; i < 6; ++i) out[2 + i] = (bits >> (40 - 8 * i)) & 0xFF;
+}
+
+// --- ASTC 4x4 ---
+// Jedna partycja, końce kolorów bezpośrednio w 8 bitach (CEM 8 RGB / CEM 12 RGBA),
+// siatka wag 4x4: 3 bity na wagę bez alfy, 2 bity z alfą (mieści się w 128 bitach).
+void setBits(uint8_t block[16], int start, int count, uint32_t value) {
+    for (int i = 0; i < count; ++i) {
+        int bit = start + i;
+        if ((value >> i) & 1) block[bit / 8] |= (uint8_t)(1 << (bit % 8));
+    }
+}
+
+void encodeASTCBlock(const uint8_t px[16][4], bool withAlpha, uint8_t out[16]) {
+    memset(out, 0, 16);
+
+    int lo[4], hi[4];
+    principalEndpoints(px, lo, hi);
+    // Suma końca 1 >= suma końca 0, inaczej dekoder zastosuje "blue contraction"
+    if (hi[0] + hi[1] + hi[2] < lo[0] + lo[1] + lo[2]) {
+        for (int c = 0; c < 3; ++c) std::swap(lo[c], hi[c]);
+    }
+    lo[3] = 255; hi[3] = 255;
+    if (withAlpha) {
+        lo[3] = 255; hi[3] = 0;
+        for (int i = 0; i < 16; ++i) {
+            lo[3] = std::min(lo[3], (int)px[i][3]);
+            hi[3] = std::max(hi[3], (int)px[i][3]);
+        }
+        // Waga jest wspólna dla wszystkich kanałów: alfa musi rosnąć w tę samą stronę co kolor
+        float covariance = 0.0f, meanT = 0.0f, meanA = 0.0f;
+        float t[16];
+        for (int i = 0; i < 16; ++i) {
+            t[i] = 0.0f;
+            for (int c = 0; c < 3; ++c) t[i] += (px[i][c] - lo[c]) * (float)(hi[c] - lo[c]);
+            meanT += t[i] / 16.0f;
+            meanA += px[i][3] / 16.0f;
+        }
+        for (int i = 0; i < 16; ++i) covariance += (t[i] - meanT) * (px[i][3] - meanA);
+        if (covariance < 0.0f) std::swap(lo[3], hi[3]);
+    }
+
+    const int weightBits = withAlpha ? 2 : 3;
+    const int levels = 1 << weightBits;
+    const int blockMode = withAlpha ? 66 : 83; // 4x4 wag, QUANT_4 / QUANT_8
+    const int cem = withAlpha ? 12 : 8;
+
+    int unq[8];
+    for (int k = 0; k < levels; ++k) {
+        int v = withAlpha ? (k << 4 | k << 2 | k) : (k << 3 | k);
+        unq[k] = v > 32 ? v + 1 : v;
+    }
+
+    setBits(out, 0, 11, blockMode);
+    setBits(out, 11, 2, 0);
+    setBits(out, 13, 4, cem);
+    int channels = withAlpha ? 4 : 3;
+    for (int c = 0; c < channels; ++c) {
+        setBits(out, 17 + c * 16, 8, lo[c]);
+        setBits(out, 17 + c * 16 + 8, 8, hi[c]);
+    }
+
+    // Wagi od góry bloku w odwróconej kolejności bitów
+    for (int i = 0; i < 16; ++i) {
+        int best = 0, bestErr = 1 << 30;
+        for (int k = 0; k < levels; ++k) {
+            int err = 0;
+            for (int c = 0; c < channels; ++c) {
+                int v = (lo[c] * (64 - unq[k]) + hi[c] * unq[k] + 32) >> 6;
+                err += (v - px[i][c]) * (v - px[i][c]);
+            }
+            if (err < bestErr) { bestErr = err; best = k; }
+        }
+        for (int b = 0; b < weightBits; ++b) {
+            if ((best >> b) & 1) {
+                int bit = 127 - (i * weightBits + b);
+                out[bit / 8] |= (uint8_t)(1 << (bit % 8));
+            }
+        }
+    }
+}
+
+// --- Kodowanie całego poziomu ---
+enum class Codec { BC, ETC1, ETC2, ASTC, Raw };
+
+std::vector<uint8_t> encodeImage(const Image& img, Codec codec, bool withAlpha) {
+    if (codec == Codec::Raw) {
+        return img.rgba;
+    }
+
+    int bw = (img.w + 3) / 4, bh = (img.h + 3) / 4;
+    size_t blockSize = (codec == Codec::ASTC || withAlpha) ? 16 : 8;
+    std::vector<uint8_t> data((size_t)bw * bh * blockSize);
+
+    // Wiersze bloków są niezależne - dzielimy je między wątki
+    auto encodeRows = [&](int firstRow, int rowStep) {
+        uint8_t px[16][4];
+        for (int by = firstRow; by < bh; by += rowStep) {
+            for (int bx = 0; bx < bw; ++bx) {
+                fetchBlock(img, bx, by, px);
+                uint8_t* out = &data[((size_t)by * bw + bx) * blockSize];
+                switch (codec) {
+                case Codec::BC:
+                    if (withAlpha) {
+                        encodeBC3AlphaBlock(px, out);
+                        encodeBC1Block(px, out + 8);
+                    } else {
+                        encodeBC1Block(px, out);
+                    }
+                    break;
+                case Codec::ETC1:
+                    encodeETC1Block(px, out);
+                    break;
+                case Codec::ETC2:
+                    if (withAlpha) {
+                        encodeEACAlphaBlock(px, out);
+                        encodeETC1Block(px, out + 8);
+                    } else {
+                        encodeETC1Block(px, out);
+                    }
+                    break;
+                case Codec::ASTC:
+                    encodeASTCBlock(px, withAlpha, out);
+                    break;
+                case Codec::Raw:
+                    break;
+                }
+            }
+        }
+    };
+
+    int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.emplace_back(encodeRows, t, threadCount);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    return data;
+}
+
+// --- Kontener KTX 1.1 ---
+void put32(std::ofstream& out, uint32_t v) {
+    out.write((const char*)&v, 4);
+}
+
+// glType/glFormat = 0 dla formatów skompresowanych
+bool writeKtx(const std::string& path, uint32_t glType, uint32_t glFormat, uint32_t internalFormat, uint32_t baseFormat,
+              int w, int h, const std::vector<std::vector<uint8_t>>& levels, const std::string& alphaMode) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cerr << "Nie mozna zapisac: " << path << "\n";
+        return false;
+    }
+
+    const uint8_t identifier[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+    out.write((const char*)identifier, 12);
+
+    // Para klucz-wartość z klasyfikacją alfy, odczytywana przez loader w cc.cpp
+    std::string kv = std::string("alphaMode") + '\0' + alphaMode + '\0';
+    uint32_t kvSize = (uint32_t)kv.size();
+    uint32_t kvPadded = (kvSize + 3) & ~3u;
+
+    put32(out, 0x04030201);
+    put32(out, glType);
+    put32(out, 1);              // glTypeSize
+    put32(out, glFormat);
+    put32(out, internalFormat);
+    put32(out, baseFormat);
+    put32(out, (uint32_t)w);
+    put32(out, (uint32_t)h);
+    put32(out, 0);              // pixelDepth
+    put32(out, 0);              // numberOfArrayElements
+    put32(out, 1);              // numberOfFaces
+    put32(out, (uint32_t)levels.size());
+    put32(out, 4 + kvPadded);   // bytesOfKeyValueData
+
+    put32(out, kvSize);
+    out.write(kv.data(), kv.size());
+    for (uint32_t i = kvSize; i < kvPadded; ++i) out.put(0);
+
+    // Rozmiary poziomów są wielokrotnością 4 (bloki 8/16 B, wiersze RGBA), więc bez dopełnień
+    for (const auto& level : levels) {
+        put32(out, (uint32_t)level.size());
+        out.write((const char*)level.data(), level.size());
+    }
+    return (bool)out;
+}
+
+bool loadImage(const fs::path& pngPath, Image& img) {
+    int comp = 0;
+    unsigned char* pixels = stbi_load(pngPath.string().c_str(), &img.w, &img.h, &comp, 4);
+    if (!pixels) {
+        std::cerr << "Nie udalo sie wczytac: " << pngPath << " (" << stbi_failure_reason() << ")\n";
+        return false;
+    }
+    img.rgba.assign(pixels, pixels + (size_t)img.w * img.h * 4);
+    stbi_image_free(pixels);
+    return true;
+}
+
+// Wszystkie warianty formatów dla gotowego łańcucha mipmap: base + ".astc.ktx" itd.
+// forceAlpha zapisuje też nieprzezroczyste tekstury w formacie z alfą (warstwy tablicy).
+void writeVariants(const std::string& base, const std::vector<Image>& mips, const std::string& alphaMode,
+                   bool forceAlpha = false) {
+    bool withAlpha = forceAlpha || alphaMode != "opaque";
+    size_t rawSize = (size_t)mips[0].w * mips[0].h * 4 * 4 / 3; // RGBA8 + mipmapy z glGenerateMipmap
+
+    struct Variant { Codec codec; const char* suffix; uint32_t rgbFormat; uint32_t rgbaFormat; };
+    const Variant variants[] = {
+        {Codec::ASTC, "astc", GL_COMPRESSED_RGBA_ASTC_4x4, GL_COMPRESSED_RGBA_ASTC_4x4},
+        {Codec::ETC2, "etc2", GL_COMPRESSED_RGB8_ETC2, GL_COMPRESSED_RGBA8_ETC2_EAC},
+        {Codec::ETC1, "etc1", GL_ETC1_RGB8, 0},
+        {Codec::BC, "bc", GL_COMPRESSED_RGB_S3TC_DXT1, GL_COMPRESSED_RGBA_S3TC_DXT5},
+        {Codec::Raw, "rgba", GL_RGBA_, GL_RGBA_},
+    };
+
+    for (const Variant& v : variants) {
+        uint32_t format = withAlpha ? v.rgbaFormat : v.rgbFormat;
+        if (format == 0) continue; // ETC1 nie ma alfy
+
+        std::vector<std::vector<uint8_t>> levels;
+        size_t totalSize = 0;
+        for (const Image& mip : mips) {
+            levels.push_back(encodeImage(mip, v.codec, withAlpha));
+            totalSize += levels.back().size();
+        }
+
+        bool raw = v.codec == Codec::Raw;
+        uint32_t baseFormat = (withAlpha || raw) ? GL_RGBA_ : GL_RGB_;
+        std::string outPath = base + "." + v.suffix + ".ktx";
+        if (writeKtx(outPath, raw ? GL_UNSIGNED_BYTE_ : 0, raw ? GL_RGBA_ : 0, format, baseFormat,
+                     mips[0].w, mips[0].h, levels, alphaMode)) {
+            std::cout << "  -> " << outPath << " " << totalSize / 1024 << " KB (RGBA8: "
+                      << rawSize / 1024 << " KB, " << (float)rawSize / totalSize << "x)\n";
+        }
+    }
+}
+
+void bakeTexture(const fs::path& pngPath) {
+    Image img;
+    if (!loadImage(pngPath, img)) return;
+
+    std::string alphaMode = classifyAlpha(img);
+    std::vector<Image> mips = buildMipChain(img, alphaMode == "mask");
+
+    std::cout << pngPath.string() << " " << img.w << "x" << img.h << " alfa: " << alphaMode
+              << ", mipmapy: " << mips.size() << " (" << mips[0].w << "x" << mips[0].h << ")\n";
+    writeVariants((pngPath.parent_path() / pngPath.stem()).string(), mips, alphaMode);
+}
+
+// --- Atlas tekstur ---
+// Tekstury materiałów trafiają do kwadratowych komórek o rozmiarze potęgi dwójki,
+// przydzielanych jak w alokatorze "buddy": komórka leży zawsze na wielokrotności
+// swojego rozmiaru, więc mipmapy z filtrem 2x2 nie mieszają sąsiadów. Margines
+// (gutter) z powielonych krawędzi chroni próbkowanie dwuliniowe na pierwszych
+// poziomach mipmap. Tekstury z różną klasą alfy trafiają na osobne strony.
+const int atlasPageSize = 4096;  // WebGL gwarantuje co najmniej tyle na większości GPU
+const int atlasMaxCell = 2048;   // cztery komórki na stronę; 2048 px traci tylko gutter (2016 px)
+const int atlasGutter = 16;      // wystarcza do 4. poziomu mipmap
+
+struct AtlasPage {
+    Image image;
+    std::string alphaMode;
+    int usedW = 0, usedH = 0;
+    std::vector<std::vector<std::pair<int, int>>> freeCells; // wolne komórki według log2(rozmiaru)
+};
+
+bool allocateCell(AtlasPage& page, int size, int& outX, int& outY) {
+    int level = 0;
+    while ((1 << level) < size) ++level;
+
+    // Najmniejsza wolna komórka >= size, dzielona na ćwiartki aż do właściwego rozmiaru
+    int found = level;
+    while (found < (int)page.freeCells.size() && page.freeCells[found].empty()) ++found;
+    if (found >= (int)page.freeCells.size()) return false;
+
+    std::pair<int, int> cell = page.freeCells[found].back();
+    page.freeCells[found].pop_back();
+    while (found > level) {
+        --found;
+        int half = 1 << found;
+        // Odkładane od końca, żeby kolejne przydziały szły wierszami od lewego górnego rogu
+        page.freeCells[found].push_back({cell.first + half, cell.second + half});
+        page.freeCells[found].push_back({cell.first, cell.second + half});
+        page.freeCells[found].push_back({cell.first + half, cell.second});
+    }
+    outX = cell.first;
+    outY = cell.second;
+    return true;
+}
+
+void blitWithGutter(Image& page, const Image& src, int cellX, int cellY, int cellSize) {
+    for (int y = 0; y < cellSize; ++y) {
+        int sy = std::clamp(y - atlasGutter, 0, src.h - 1);
+        for (int x = 0; x < cellSize; ++x) {
+            int sx = std::clamp(x - atlasGutter, 0, src.w - 1);
+            memcpy(&page.rgba[((size_t)(cellY + y) * page.w + cellX + x) * 4], &src.rgba[((size_t)sy * src.w + sx) * 4], 4);
+        }
+    }
+}
+
+// Tworzy atlas*.ktx i atlas.txt z tekstur PNG bezpośrednio w katalogu (bez podkatalogów).
+// cc.cpp przy ładowaniu modelu przelicza UV submeshy na prostokąty z atlas.txt.
+void bakeAtlas(const std::string& dir) {
+    struct Item { std::string name; Image img; std::string alphaMode; int cell; };
+    std::vector<Item> items;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (!entry.is_regular_file() || ext != ".png") continue;
+
+        Item item;
+        item.name = entry.path().filename().string();
+        if (!loadImage(entry.path(), item.img)) continue;
+        item.alphaMode = classifyAlpha(item.img);
+        // Komórka mieści teksturę razem z gutterem, wtedy nie jest przeskalowywana
+        item.cell = 1;
+        while (item.cell < std::max(item.img.w, item.img.h) + 2 * atlasGutter && item.cell < atlasMaxCell) item.cell <<= 1;
+        items.push_back(std::move(item));
+    }
+
+    // Największe najpierw - alokator buddy wtedy się nie fragmentuje
+    std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) {
+        return a.cell != b.cell ? a.cell > b.cell : a.name < b.name;
+    });
+
+    struct Placement { std::string name; size_t page; int x, y, inner; };
+    std::vector<AtlasPage> pages;
+    std::vector<Placement> placements;
+
+    for (Item& item : items) {
+        int x = 0, y = 0;
+        AtlasPage* page = nullptr;
+        for (auto& p : pages) {
+            if (p.alphaMode == item.alphaMode && allocateCell(p, item.cell, x, y)) {
+                page = &p;
+                break;
+            }
+        }
+        if (!page) {
+            AtlasPage fresh;
+            fresh.alphaMode = item.alphaMode;
+            fresh.image.w = fresh.image.h = atlasPageSize;
+            fresh.image.rgba.assign((size_t)atlasPageSize * atlasPageSize * 4, 0);
+            int levels = 0;
+            while ((1 << levels) <= atlasPageSize) ++levels;
+            fresh.freeCells.resize(levels);
+            fresh.freeCells[levels - 1].push_back({0, 0});
+            pages.push_back(std::move(fresh));
+            page = &pages.back();
+            allocateCell(*page, item.cell, x, y);
+        }
+
+        int size = std::max(item.img.w, item.img.h);
+        int inner = std::min(item.cell - 2 * atlasGutter, size);
+        if (inner < size) {
+            std::cout << "Atlas: " << item.name << " zmniejszona z " << size << " do " << inner << " px\n";
+        }
+        Image scaled = (inner == item.img.w && inner == item.img.h) ? item.img : resizeTo(item.img, inner, inner);
+        blitWithGutter(page->image, scaled, x, y, item.cell);
+        page->usedW = std::max(page->usedW, x + item.cell);
+        page->usedH = std::max(page->usedH, y + item.cell);
+
+        size_t pageIndex = page - pages.data();
+        placements.push_back({item.name, pageIndex, x + atlasGutter, y + atlasGutter, inner});
+        std::cout << "Atlas: " << item.name << " -> atlas" << pageIndex << " (" << x << "," << y << ") " << item.cell << "px\n";
+    }
+
+    // Niepełne strony przycinamy do najmniejszej potęgi dwójki obejmującej komórki
+    for (AtlasPage& page : pages) {
+        int w = 1, h = 1;
+        while (w < page.usedW) w <<= 1;
+        while (h < page.usedH) h <<= 1;
+        if (w == page.image.w && h == page.image.h) continue;
+
+        Image cropped;
+        cropped.w = w;
+        cropped.h = h;
+        cropped.rgba.resize((size_t)w * h * 4);
+        for (int y = 0; y < h; ++y) {
+            memcpy(&cropped.rgba[(size_t)y * w * 4], &page.image.rgba[(size_t)y * page.image.w * 4], (size_t)w * 4);
+        }
+        page.image = std::move(cropped);
+    }
+
+    std::ofstream manifest(dir + "/atlas.txt");
+    manifest << "# tekstura strona u0 v0 u1 v1\n";
+    for (const Placement& p : placements) {
+        const Image& page = pages[p.page].image;
+        manifest << p.name << " atlas" << p.page << " "
+                 << (float)p.x / page.w << " " << (float)p.y / page.h << " "
+                 << (float)(p.x + p.inner) / page.w << " " << (float)(p.y + p.inner) / page.h << "\n";
+    }
+
+    for (size_t i = 0; i < pages.size(); ++i) {
+        std::vector<Image> mips = buildMipChain(pages[i].image, pages[i].alphaMode == "mask", true);
+        std::cout << "Strona atlasu " << i << " " << pages[i].image.w << "x" << pages[i].image.h
+                  << " (" << pages[i].alphaMode << ")\n";
+        writeVariants(dir + "/atlas" + std::to_string(i), mips, pages[i].alphaMode);
+    }
+}
+
+// --- Warstwy tablicy tekstur ---
+// Tablica ma jeden rozmiar i jeden format dla wszystkich warstw, więc bake robi to raz
+// offline: bok warstwy to najdłuższy bok tekstur zaokrąglony w górę do potęgi dwójki
+// (najwyżej arrayMaxLayer, tak samo liczy cc.cpp dla PNG), a każda warstwa ma format z alfą.
+// Tekstury blend nie trafiają do tablicy (muszą być sortowane), więc nie są tu zapisywane.
+const int arrayMaxLayer = 2048;
+
+void bakeArrayLayers(const std::string& dir) {
+    struct Item { fs::path path; Image img; std::string alphaMode; };
+    std::vector<Item> items;
+    int longest = 1;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (!entry.is_regular_file() || ext != ".png") continue;
+
+        Item item;
+        item.path = entry.path();
+        if (!loadImage(entry.path(), item.img)) continue;
+        item.alphaMode = classifyAlpha(item.img);
+        if (item.alphaMode == "blend") {
+            std::cout << "Tablica: " << item.path.filename().string() << " pominieta (blend)\n";
+            continue;
+        }
+        longest = std::max({longest, item.img.w, item.img.h});
+        items.push_back(std::move(item));
+    }
+
+    int layerSize = 1;
+    while (layerSize < longest && layerSize < arrayMaxLayer) layerSize <<= 1;
+    std::cout << "Tablica tekstur: " << items.size() << " warstw " << layerSize << "x" << layerSize << "\n";
+
+    for (const Item& item : items) {
+        const Image& img = item.img;
+        Image layer = (img.w == layerSize && img.h == layerSize) ? img : resizeTo(img, layerSize, layerSize);
+        std::vector<Image> mips = buildMipChain(layer, item.alphaMode == "mask");
+        std::cout << item.path.string() << " " << img.w << "x" << img.h << " -> warstwa " << layerSize << "x"
+                  << layerSize << " alfa: " << item.alphaMode << "\n";
+        writeVariants((item.path.parent_path() / item.path.stem()).string() + ".array", mips, item.alphaMode, true);
+    }
+}
+
+// --- Test koderów (--selftest) ---
+// Dekodery napisane osobno według specyfikacji formatów (nie odwracają kodu koderów):
+// blok zakodowany przez bake musi być poprawny dla dekodera i wracać z ograniczonym błędem.
+int clamp255(int v) { return std::clamp(v, 0, 255); }
+
+void decodeBC1Block(const uint8_t in[8], uint8_t out[16][4]) {
+    uint16_t c0 = (uint16_t)(in[0] | in[1] << 8), c1 = (uint16_t)(in[2] | in[3] << 8);
+    int pal[4][4];
+    for (int k = 0; k < 2; ++k) {
+        uint16_t c = k ? c1 : c0;
+        pal[k][0] = ((c >> 11) & 31) * 255 / 31;
+        pal[k][1] = ((c >> 5) & 63) * 255 / 63;
+        pal[k][2] = (c & 31) * 255 / 31;
+        pal[k][3] = 255;
+    }
+    for (int ch = 0; ch < 3; ++ch) {
+        if (c0 > c1) {
+            pal[2][ch] = (2 * pal[0][ch] + pal[1][ch] + 1) / 3;
+            pal[3][ch] = (pal[0][ch] + 2 * pal[1][ch] + 1) / 3;
+        } else {
+            pal[2][ch] = (pal[0][ch] + pal[1][ch]) / 2;
+            pal[3][ch] = 0;
+        }
+    }
+    pal[2][3] = 255;
+    pal[3][3] = c0 > c1 ? 255 : 0;
+    uint32_t indices = (uint32_t)in[4] | (uint32_t)in[5] << 8 | (uint32_t)in[6] << 16 | (uint32_t)in[7] << 24;
+    for (int i = 0; i < 16; ++i) {
+        int k = (indices >> (2 * i)) & 3;
+        for (int ch = 0; ch < 4; ++ch) out[i][ch] = (uint8_t)pal[k][ch];
+    }
+}
+
+void decodeBC3AlphaBlock(const uint8_t in[8], uint8_t out[16][4]) {
+    int a0 = in[0], a1 = in[1];
+    int pal[8] = {a0, a1};
+    if (a0 > a1) {
+        for (int k = 1; k <= 6; ++k) pal[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+    } else {
+        for (int k = 1; k <= 4; ++k) pal[k + 1] = ((5 - k) * a0 + k * a1) / 5;
+        pal[6] = 0;
+        pal[7] = 255;
+    }
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; ++i) indices |= (uint64_t)in[2 + i] << (8 * i);
+    for (int i = 0; i < 16; ++i) out[i][3] = (uint8_t)pal[(indices >> (3 * i)) & 7];
+}
+
+// false: blok w trybie, którego ETC1 nie zna (przepełnienie różnicy = tryb T/H/planar ETC2)
+bool decodeETC1Block(const uint8_t in[8], uint8_t out[16][4]) {
+    static const int intensity[8][2] = {{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}};
+    uint64_t w = 0;
+    for (int i = 0; i < 8; ++i) w = w << 8 | in[i];
+    bool diff = (w >> 33) & 1, flip = (w >> 32) & 1;
+
+    int base[2][3];
+    for (int ch = 0; ch < 3; ++ch) {
+        int shift = 59 - 8 * ch;  // R od bitu 63, G od 55, B od 47
+        if (diff) {
+            int b0 = (int)((w >> shift) & 31);
+            int d = (int)((w >> (shift - 3)) & 7);
+            if (d >= 4) d -= 8;
+            int b1 = b0 + d;
+            if (b1 < 0 || b1 > 31) return false;
+            base[0][ch] = (b0 << 3) | (b0 >> 2);
+            base[1][ch] = (b1 << 3) | (b1 >> 2);
+        } else {
+            int b0 = (int)((w >> (shift + 1)) & 15), b1 = (int)((w >> (shift - 3)) & 15);
+            base[0][ch] = b0 * 17;
+            base[1][ch] = b1 * 17;
+        }
+    }
+    int table[2] = {(int)((w >> 37) & 7), (int)((w >> 34) & 7)};
+
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            int sub = flip ? (y >= 2) : (x >= 2);
+            int bit = x * 4 + y;
+            int msb = (int)((w >> (16 + bit)) & 1), lsb = (int)((w >> bit) & 1);
+            int modifier = intensity[table[sub]][lsb] * (msb ? -1 : 1);
+            for (int ch = 0; ch < 3; ++ch) out[y * 4 + x][ch] = (uint8_t)clamp255(base[sub][ch] + modifier);
+            out[y * 4 + x][3] = 255;
+        }
+    }
+    return true;
+}
+
+void decodeEACAlphaBlock(const uint8_t in[8], uint8_t out[16][4]) {
+    static const int table[16][4] = {
+        {2, 5, 8, 14}, {2, 6, 9, 12}, {1, 4, 7, 12}, {1, 3, 5, 12}, {2, 5, 7, 11}, {2, 6, 8, 10}, {3, 6, 7, 10}, {2, 4, 7, 10},
+        {1, 5, 7, 9}, {1, 4, 7, 9}, {1, 3, 7, 9}, {1, 4, 6, 9}, {2, 3, 6, 9}, {0, 1, 2, 9}, {3, 5, 7, 8}, {2, 4, 6, 8}};
+    int base = in[0], mul = in[1] >> 4, t = in[1] & 15;
+    uint64_t bits = 0;
+    for (int i = 2; i < 8; ++i) bits = bits << 8 | in[i];
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            int k = (int)((bits >> (45 - 3 * (x * 4 + y))) & 7);
+            // Indeksy 4-7 dodatnie, 0-3 ujemne: w tablicach ETC2 modyfikator ujemny = -(dodatni + 1)
+            int modifier = k >= 4 ? table[t][k - 4] : -(table[t][k] + 1);
+            out[y * 4 + x][3] = (uint8_t)clamp255(base + modifier * mul);
+        }
+    }
+}
+
+// Podzbiór ASTC LDR: jedna partycja, jedna płaszczyzna wag, siatka 4x4, wagi zapisane samymi
+// bitami i końce CEM 8/12 o pełnej precyzji. false dla bloku spoza podzbioru.
+bool decodeASTCBlock(const uint8_t in[16], uint8_t out[16][4]) {
+    auto bits = [&](int start, int count) {
+        uint32_t v = 0;
+        for (int i = 0; i < count; ++i) v |= (uint32_t)((in[(start + i) / 8] >> ((start + i) % 8)) & 1) << i;
+        return v;
+    };
+    uint32_t mode = bits(0, 11);
+    if ((mode & 3) == 0 || (mode & 0x1FC) == 0x1FC) return false;  // inne układy i void-extent
+    if (((mode >> 2) & 3) != 0) return false;                      // tylko wariant W=B+4, H=A+2
+    int width = (int)((mode >> 7) & 3) + 4, height = (int)((mode >> 5) & 3) + 2;
+    int range = (int)(((mode >> 4) & 1) | (mode & 3) << 1);
+    bool highPrecision = (mode >> 9) & 1, dualPlane = (mode >> 10) & 1;
+    if (width != 4 || height != 4 || highPrecision || dualPlane) return false;
+
+    static const int unquant1[2] = {0, 64};
+    static const int unquant2[4] = {0, 21, 43, 64};
+    static const int unquant3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+    int weightBits = range == 2 ? 1 : range == 4 ? 2 : range == 7 ? 3 : 0;
+    if (weightBits == 0) return false;  // zakres z trytami/kwintami
+    const int* unquant = weightBits == 1 ? unquant1 : weightBits == 2 ? unquant2 : unquant3;
+
+    if (bits(11, 2) != 0) return false;  // jedna partycja
+    int cem = (int)bits(13, 4);
+    if (cem != 8 && cem != 12) return false;
+    int valueCount = cem == 8 ? 6 : 8;
+    if (valueCount * 8 > 128 - 17 - 16 * weightBits) return false;  // 256 poziomów musi się zmieścić
+
+    int v[8];
+    for (int k = 0; k < valueCount; ++k) v[k] = (int)bits(17 + 8 * k, 8);
+    int e0[4], e1[4];
+    if (v[1] + v[3] + v[5] >= v[0] + v[2] + v[4]) {
+        for (int ch = 0; ch < 3; ++ch) { e0[ch] = v[2 * ch]; e1[ch] = v[2 * ch + 1]; }
+        e0[3] = cem == 12 ? v[6] : 255;
+        e1[3] = cem == 12 ? v[7] : 255;
+    } else {
+        // "blue contraction"
+        e0[0] = (v[1] + v[5]) >> 1; e0[1] = (v[3] + v[5]) >> 1; e0[2] = v[5];
+        e1[0] = (v[0] + v[4]) >> 1; e1[1] = (v[2] + v[4]) >> 1; e1[2] = v[4];
+        e0[3] = cem == 12 ? v[7] : 255;
+        e1[3] = cem == 12 ? v[6] : 255;
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        int q = 0;
+        for (int b = 0; b < weightBits; ++b) q |= ((in[(127 - (i * weightBits + b)) / 8] >> ((127 - (i * weightBits + b)) % 8)) & 1) << b;
+        int weight = unquant[q];
+        for (int ch = 0; ch < 4; ++ch) {
+            int c0 = e0[ch] * 257, c1 = e1[ch] * 257;
+            out[i][ch] = (uint8_t)(((c0 * (64 - weight) + c1 * weight + 32) >> 6) >> 8);
+        }
+    }
+    return true;
+}
+
+bool decodeBlock(Codec codec, bool withAlpha, const uint8_t* in, uint8_t out[16][4]) {
+    switch (codec) {
+    case Codec::BC:
+        if (!withAlpha) {
+            decodeBC1Block(in, out);
+            return true;
+        }
+        decodeBC1Block(in + 8, out);
+        decodeBC3AlphaBlock(in, out);
+        return true;
+    case Codec::ETC1:
+        return decodeETC1Block(in, out);
+    case Codec::ETC2:
+        if (!withAlpha) return decodeETC1Block(in, out);
+        if (!decodeETC1Block(in + 8, out)) return false;
+        decodeEACAlphaBlock(in, out);
+        return true;
+    case Codec::ASTC:
+        return decodeASTCBlock(in, out);
+    case Codec::Raw:
+        break;
+    }
+    return false;
+}
+
+int runSelfTest() {
+    struct Case { Codec codec; bool withAlpha; const char* name; double maxSmoothRmse; int maxFlatError; };
+    const Case cases[] = {
+        // Limity ~10% nad wynikami obecnych koderów: wykrywają regresję albo niezgodność z formatem
+        {Codec::BC, false, "BC1", 11.0, 6},
+        {Codec::BC, true, "BC3", 10.0, 6},
+        {Codec::ETC1, false, "ETC1", 20.0, 7},
+        {Codec::ETC2, false, "ETC2 RGB8", 20.0, 7},
+        {Codec::ETC2, true, "ETC2 RGBA8", 18.0, 7},
+        {Codec::ASTC, false, "ASTC RGB", 6.5, 1},
+        {Codec::ASTC, true, "ASTC RGBA", 12.0, 1},
+    };
+    const int blocksPerKind = 2000;
+    std::mt19937 rng(20240601);
+    std::uniform_int_distribution<int> byte(0, 255), noise(-6, 6);
+
+    bool ok = true;
+    for (const Case& c : cases) {
+        int invalid = 0, flatWorst = 0;
+        double smoothSq = 0.0;
+        int channels = c.withAlpha ? 4 : 3;
+        for (int kind = 0; kind < 3; ++kind) {
+            for (int n = 0; n < blocksPerKind; ++n) {
+                // 0: stały kolor, 1: gradient z szumem, 2: czysty szum (tylko poprawność bloku)
+                uint8_t px[16][4];
+                int a[4], b[4];
+                for (int ch = 0; ch < 4; ++ch) { a[ch] = byte(rng); b[ch] = byte(rng); }
+                for (int i = 0; i < 16; ++i) {
+                    for (int ch = 0; ch < 4; ++ch) {
+                        int v = a[ch];
+                        if (kind == 1) v = a[ch] + (b[ch] - a[ch]) * ((i % 4) + (i / 4)) / 6 + noise(rng);
+                        if (kind == 2) v = byte(rng);
+                        px[i][ch] = (uint8_t)clamp255(v);
+                    }
+                    if (!c.withAlpha) px[i][3] = 255;
+                }
+
+                Image img;
+                img.w = img.h = 4;
+                img.rgba.assign(&px[0][0], &px[0][0] + 64);
+                std::vector<uint8_t> block = encodeImage(img, c.codec, c.withAlpha);
+                uint8_t decoded[16][4];
+                if (!decodeBlock(c.codec, c.withAlpha, block.data(), decoded)) {
+                    ++invalid;
+                    continue;
+                }
+                for (int i = 0; i < 16; ++i) {
+                    for (int ch = 0; ch < channels; ++ch) {
+                        int e = decoded[i][ch] - px[i][ch];
+                        if (kind == 0) flatWorst = std::max(flatWorst, std::abs(e));
+                        if (kind == 1) smoothSq += e * e;
+                    }
+                }
+            }
+        }
+        double smoothRmse = std::sqrt(smoothSq / (blocksPerKind * 16.0 * channels));
+        bool pass = invalid == 0 && smoothRmse <= c.maxSmoothRmse && flatWorst <= c.maxFlatError;
+        ok = ok && pass;
+        std::cout << (pass ? "OK   " : "BLAD ") << c.name << ": niepoprawnych blokow " << invalid << ", RMSE gradientu "
+                  << smoothRmse << " (limit " << c.maxSmoothRmse << "), blad stalego koloru " << flatWorst << " (limit "
+                  << c.maxFlatError << ")\n";
+    }
+    return ok ? 0 : 1;
+}
+
+// --- Manifest zasobów ---
+uint64_t fnv1a64(const unsigned char* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// "sciezka rozmiar skrot [=oryginal]", ścieżki względem katalogu nad dir (np. asserts/el.fbx)
+void writeManifest(const std::string& dir) {
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::recursive_directory_iterator(dir)) {
+        if (entry.is_regular_file() && entry.path().filename() != "manifest.txt") files.push_back(entry.path());
+    }
+    std::sort(files.begin(), files.end());
+
+    std::ofstream manifest(fs::path(dir) / "manifest.txt");
+    manifest << "# sciezka rozmiar fnv1a64 [=plik o tej samej tresci]\n";
+    std::map<std::pair<uintmax_t, uint64_t>, std::string> seen;
+    uintmax_t totalBytes = 0, duplicateBytes = 0;
+    for (const fs::path& file : files) {
+        std::ifstream in(file, std::ios::binary);
+        std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        uint64_t hash = fnv1a64(bytes.data(), bytes.size());
+        std::string path = file.generic_string();
+
+        manifest << path << " " << bytes.size() << " " << std::hex << std::setw(16) << std::setfill('0') << hash
+                 << std::dec;
+        auto key = std::make_pair((uintmax_t)bytes.size(), hash);
+        auto original = seen.find(key);
+        if (original != seen.end()) {
+            manifest << " =" << original->second;
+            duplicateBytes += bytes.size();
+            std::cout << "Duplikat: " << path << " == " << original->second << "\n";
+        } else {
+            seen[key] = path;
+        }
+        manifest << "\n";
+        totalBytes += bytes.size();
+    }
+    std::cout << "Manifest: " << files.size() << " plikow, " << totalBytes / 1024 << " KB, duplikaty "
+              << duplicateBytes / 1024 << " KB\n";
+}
+
+int main(int argc, char** argv) {
+    std::string dir = "asserts";
+    bool atlas = false;
+    bool array = false;
+    bool manifest = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--atlas") {
+            atlas = true;
+        } else if (arg == "--array") {
+            array = true;
+        } else if (arg == "--manifest") {
+            manifest = true;
+        } else if (arg == "--selftest") {
+            return runSelfTest();
+        } else {
+            dir = arg;
+        }
+    }
+    initSrgbTable();
+    if (!fs::is_directory(dir)) {
+        std::cerr << "Brak katalogu: " << dir << "\n";
+        return 1;
+    }
+
+    for (const auto& entry : fs::recursive_directory_iterator(dir)) {
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (entry.is_regular_file() && ext == ".png") {
+            bakeTexture(entry.path());
+        }
+    }
+
+    if (atlas) {
+        bakeAtlas(dir);
+    }
+    if (array) {
+        bakeArrayLayers(dir);
+    }
+    if (manifest) {
+        writeManifest(dir);
+    }
+    return 0;
+}
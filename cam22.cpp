@@ -1,7 +1,7 @@
 #include <SDL.h>
 #include <SDL_image.h>
 #include <GLES2/gl2.h>
-#include <emscripten.h>
+#include "platform.h"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -433,7 +433,7 @@ void main_loop() {
     SDL_Event e;
     while (SDL_PollEvent(&e)) {
         if (e.type == SDL_QUIT) {
-            emscripten_cancel_main_loop();
+            platformQuit();
         } 
         
         // --- OBSŁUGA MYSZY ---
@@ -536,7 +536,7 @@ int main() {
     harpyModel.load("asserts/el.fbx", "asserts"); 
     std::cout << "Model zaladowany. Liczba meshy: " << harpyModel.meshes.size() << std::endl;
     
-    emscripten_set_main_loop(main_loop, 0, 1);
+    platformRun(main_loop);
     
     cleanup();
 
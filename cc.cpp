@@ -1,8 +1,9 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <SDL.h>
-#include <SDL_image.h>
-#include <GLES2/gl2.h>
-#include <emscripten.h>
+#include <GLES3/gl3.h>
+#include "platform.h"
+#include "interleave.h"
+#include "jobs.h"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -10,7 +11,40 @@
 #include <vector>
 #include <string>
 #include <cmath>
+#include <cstring>
+#include <cstdlib>
 #include <iostream>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <set>
+#include <map>
+#include <new>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <climits>
+#include <cstdint>
+#include <malloc.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/fetch.h>
+#endif
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -19,10 +53,183 @@
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtx/rotate_vector.hpp>
 
+// PNG/JPG dekoduje stb_image; jego bufory pochodzą z puli (definicje niżej)
+void* stagingAlloc(size_t size);
+void* stagingRealloc(void* ptr, size_t size);
+void stagingFree(void* ptr);
+#define STBI_MALLOC(sz) stagingAlloc(sz)
+#define STBI_REALLOC(p, newsz) stagingRealloc(p, newsz)
+#define STBI_FREE(p) stagingFree(p)
+#define STBI_ONLY_PNG
+#define STBI_ONLY_JPEG
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// --- Licznik alokacji (tylko z -DHEAP_STATS) ---
+// Każde new/delete z programu i bibliotek C++ (w tym Assimpa) przechodzi tędy; Model::load
+// raportuje liczbę alokacji i szczyt sterty całego ładowania. Bajty liczone są według
+// malloc_usable_size, a szczyt od ostatniego resetHeapPeak() pokazuje, do ilu urosła
+// pamięć wasm (ALLOW_MEMORY_GROWTH nigdy jej nie oddaje). Bloki aligned_alloc z areny
+// geometrii i puli dekodowania zgłaszają się przez countHeapAlloc/countHeapFree.
+// W zwykłym buildzie operator new nie jest podmieniany, a oba wywołania nic nie robią.
+#ifdef HEAP_STATS
+std::atomic<size_t> heapAllocationCount(0);
+std::atomic<size_t> heapBytes(0);
+std::atomic<size_t> heapPeakBytes(0);
+
+void countHeapAlloc(void* ptr) {
+    if (!ptr) return;
+    heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    size_t usable = malloc_usable_size(ptr);
+    size_t now = heapBytes.fetch_add(usable, std::memory_order_relaxed) + usable;
+    size_t peak = heapPeakBytes.load(std::memory_order_relaxed);
+    while (now > peak && !heapPeakBytes.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+    }
+}
+
+void countHeapFree(void* ptr) {
+    if (ptr) heapBytes.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+}
+
+void* operator new(size_t size) {
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    countHeapAlloc(ptr);
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    countHeapFree(ptr);
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    countHeapFree(ptr);
+    free(ptr);
+}
+
+void resetHeapPeak() {
+    heapPeakBytes.store(heapBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+#else
+inline void countHeapAlloc(void*) {}
+inline void countHeapFree(void*) {}
+#endif
+
+// Stan liczników na początku mierzonego odcinka; bez HEAP_STATS same zera i brak raportu
+struct HeapSnapshot {
+    size_t allocations = 0;
+    size_t bytes = 0;
+};
+
+HeapSnapshot beginHeapMeasure() {
+    HeapSnapshot start;
+#ifdef HEAP_STATS
+    resetHeapPeak();
+    start.allocations = heapAllocationCount;
+    start.bytes = heapBytes;
+#endif
+    return start;
+}
+
+void reportHeapMeasure(const char* what, const HeapSnapshot& start) {
+#ifdef HEAP_STATS
+    std::cout << what << ": " << heapAllocationCount - start.allocations << " alokacji sterty, szczyt "
+              << heapPeakBytes / 1024 << " KB (przed " << start.bytes / 1024 << " KB, po " << heapBytes / 1024 << " KB)\n";
+#else
+    (void)what;
+    (void)start;
+#endif
+}
+
+// --- Licznik zasobów GPU ---
+// Rozmiar każdego bufora i tekstury (z całym łańcuchem mipmap) zapisywany jest przy
+// uploadzie i zdejmowany przy glDelete*. Model::memoryUsage() i Mesh::memoryUsage()
+// sumują to dla swoich obiektów, dumpMemory() wypisuje całość (klawisz M).
+enum class GpuResource { VertexBuffer, IndexBuffer, Texture, Renderbuffer, Count };
+
+const char* gpuResourceNames[] = {"VBO", "IBO", "tekstury", "renderbuffery"};
+
+class ResourceTracker {
+public:
+    // Ponowny upload do tego samego obiektu zastępuje poprzedni rozmiar
+    void record(GpuResource kind, GLuint id, size_t bytes);
+    void release(GpuResource kind, GLuint id);
+    size_t bytes(GpuResource kind, GLuint id) const;
+    size_t total(GpuResource kind) const;
+    size_t totalGpu() const;
+
+private:
+    // Wątek GL (streamer, FBO) zapisuje, symulacja czyta przy zrzucie
+    mutable std::mutex lock;
+    std::map<std::pair<GpuResource, GLuint>, size_t> sizes;
+    size_t totals[(int)GpuResource::Count] = {};
+};
+
+ResourceTracker resourceTracker;
+
+void ResourceTracker::record(GpuResource kind, GLuint id, size_t bytes) {
+    std::lock_guard<std::mutex> guard(lock);
+    size_t& entry = sizes[{kind, id}];
+    totals[(int)kind] += bytes - entry;
+    entry = bytes;
+}
+
+void ResourceTracker::release(GpuResource kind, GLuint id) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = sizes.find({kind, id});
+    if (it == sizes.end()) return;
+    totals[(int)kind] -= it->second;
+    sizes.erase(it);
+}
+
+size_t ResourceTracker::bytes(GpuResource kind, GLuint id) const {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = sizes.find({kind, id});
+    return it == sizes.end() ? 0 : it->second;
+}
+
+size_t ResourceTracker::total(GpuResource kind) const {
+    std::lock_guard<std::mutex> guard(lock);
+    return totals[(int)kind];
+}
+
+size_t ResourceTracker::totalGpu() const {
+    std::lock_guard<std::mutex> guard(lock);
+    size_t sum = 0;
+    for (size_t t : totals) sum += t;
+    return sum;
+}
+
+// Bajty tekstury nieskompresowanej razem z mipmapami do 1x1
+size_t mipChainBytes(int width, int height, int bytesPerPixel, bool mipmapped) {
+    size_t bytes = 0;
+    while (true) {
+        bytes += (size_t)width * height * bytesPerPixel;
+        if (!mipmapped || (width == 1 && height == 1)) break;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return bytes;
+}
+
+// Pamięć obiektu (Mesh, Model) według resourceTracker
+struct MemoryUsage {
+    size_t vertexBytes = 0;
+    size_t indexBytes = 0;
+    size_t textureBytes = 0;
+
+    size_t total() const { return vertexBytes + indexBytes + textureBytes; }
+};
+
 // --- Globalne zmienne ---
 SDL_Window* window = nullptr;
 SDL_GLContext glContext = nullptr;
-GLuint program = 0;
+
+// Rozmiar okna w jednostkach zdarzeń (mysz, dotyk) i bufora ramki w pikselach
+// (na ekranach HiDPI bufor jest większy); odczytywane z SDL przy starcie i po zmianie rozmiaru
+int windowWidth = 640, windowHeight = 480;
+int drawableWidth = 640, drawableHeight = 480;
 
 // Zmienne dla kamery orbitalnej
 float cameraDistance = 5.0f;
@@ -32,18 +239,69 @@ glm::vec3 cameraTarget = glm::vec3(0.0f, 0.5f, 0.0f);
 glm::vec3 worldUp = glm::vec3(0.0f, 1.0f, 0.0f);
 float modelRotationY = 0.0f;
 float modelRotationX = 0.0f;
-bool mouseDown = false;
-int lastX, lastY;
 
-float initialFingerDistance = 0.0f;
 float zoomSpeed = 0.05f;
 float rotationSpeed = 0.005f;
 
-// Lokalizacje uniformów w shaderze
-GLint uniformMVPLoc;
-GLint uniformModelLoc;
+// Stan gestów - należy do warstwy wejścia, render() go nie czyta
+struct GestureState {
+    bool pointerDown = false;        // lewy przycisk albo jeden palec
+    float lastX = 0.0f, lastY = 0.0f;
+    float pressX = 0.0f, pressY = 0.0f;  // gdzie zaczął się gest - krótki gest to tapnięcie
+    bool dragRotatesModel = false;   // palec złapał model - przeciąganie obraca model, nie kamerę
+    float pinchDistance = 0.0f;      // odległość dwóch palców przy ostatnim zdarzeniu
+};
+GestureState gesture;
+
+// Wybór submesha kliknięciem/dotknięciem: promień budowany z macierzy ostatniej klatki
+glm::mat4 lastViewProjection = glm::mat4(1.0f);
+int selectedMesh = -1;
+
+// Rysowanie na żądanie: klatka powstaje tylko wtedy, gdy coś ją unieważniło
+// (wejście, ruch kamery, strumieniowanie tekstur, zmiana rozmiaru okna)
+struct FrameScheduler {
+    bool dirty = true;
+    unsigned long rendered = 0;
+    unsigned long skipped = 0;
+    double lastReport = 0.0;
+
+    void invalidate() { dirty = true; }
+};
+FrameScheduler frameScheduler;
+
+// Tryby renderowania (przełączane klawiszami P i O)
+bool depthPrepassEnabled = false; // najpierw sama głębokość, potem cieniowanie z GL_EQUAL
+bool overdrawView = false;        // wizualizacja liczby wywołań fragment shadera
+GLuint depthProgram = 0;
+GLuint overdrawProgram = 0;
+
+// Warianty shadera materiału: jeden program na kombinację trybu alfy i używanych slotów.
+// Kompilowane przy pierwszym użyciu, więc materiał z samym diffuse zostaje przy najtańszym.
+enum ShaderFeature : unsigned {
+    SHADER_ALPHA_MASK   = 1u << 0,  // alpha-test (discard)
+    SHADER_ALPHA_BLEND  = 1u << 1,  // półprzezroczystość, rysowane od tyłu do przodu
+    SHADER_NORMAL_MAP   = 1u << 2,  // wymaga stycznych w strumieniu wierzchołków
+    SHADER_SPECULAR_MAP = 1u << 3,
+    SHADER_EMISSIVE_MAP = 1u << 4,
+};
+std::map<unsigned, GLuint> shaderVariants;
+GLuint depthProgramMasked = 0; // pre-pass z tym samym discard co wariant SHADER_ALPHA_MASK
+
+// Backend wybierany przy tworzeniu kontekstu: WebGL2/GLES3 rysuje nieprzezroczyste
+// submeshe modelu jednym wywołaniem z tablicą tekstur, WebGL1/GLES2 - po jednym na Mesh
+enum class RenderBackend { GLES2, GLES3 };
+RenderBackend renderBackend = RenderBackend::GLES2;
+GLuint arrayProgram = 0;
+GLuint arrayDepthProgram = 0;
+GLuint arrayProgramMasked = 0;       // tablica z warstwami alpha-test
+GLuint arrayDepthProgramMasked = 0;
 
-// --- Shadery (bez zmian) ---
+// Stałe lokalizacje atrybutów - createProgram wiąże je we wszystkich programach
+enum AttribLocation { ATTR_POS = 0, ATTR_NORMAL = 1, ATTR_UV = 2, ATTR_LAYER = 3, ATTR_TANGENT = 4 };
+
+// --- Shadery ---
+// Warianty (mapy normalnych, specular i emisji, alfa mask/blend) wybierają definicje,
+// które createProgram dopisuje przed źródłem
 const char* vs = R"(
 attribute vec3 aPos;
 attribute vec3 aNormal;
@@ -52,13 +310,34 @@ attribute vec2 aUV;
 varying vec3 vNormal;
 varying vec2 vUV;
 
+#ifdef NORMAL_MAP
+// xyz - styczna, w - znak bitangenty (GL_BYTE znormalizowane)
+attribute vec4 aTangent;
+varying vec3 vTangent;
+varying float vBitangentSign;
+#endif
+
+#ifdef SPECULAR_MAP
+varying vec3 vWorldPos;
+#endif
+
 uniform mat4 MVP;
 uniform mat4 Model;
 
+// Pre-pass i przebieg główny muszą policzyć identyczną głębokość (GL_EQUAL)
+invariant gl_Position;
+
 void main(){
     gl_Position = MVP * vec4(aPos, 1.0);
     vNormal = normalize(mat3(Model) * aNormal);
     vUV = aUV;
+#ifdef NORMAL_MAP
+    vTangent = normalize(mat3(Model) * aTangent.xyz);
+    vBitangentSign = aTangent.w;
+#endif
+#ifdef SPECULAR_MAP
+    vWorldPos = (Model * vec4(aPos, 1.0)).xyz;
+#endif
 }
 )";
 
@@ -69,105 +348,537 @@ uniform sampler2D tex;
 varying vec2 vUV;
 varying vec3 vNormal;
 
+#ifdef NORMAL_MAP
+uniform sampler2D normalMap;
+varying vec3 vTangent;
+varying float vBitangentSign;
+#endif
+
+#ifdef SPECULAR_MAP
+uniform sampler2D specularMap;
+uniform vec3 CameraPos;
+varying vec3 vWorldPos;
+#endif
+
+#ifdef EMISSIVE_MAP
+uniform sampler2D emissiveMap;
+#endif
+
+uniform float Highlight;  // 1 dla submesha wybranego dotknięciem
+
 void main() {
-    vec3 texColor = texture2D(tex, vUV).rgb;
+    vec4 texSample = texture2D(tex, vUV);
+#ifdef ALPHA_MASK
+    if (texSample.a < 0.5) discard;
+#endif
+    vec3 texColor = texSample.rgb;
+
+    vec3 normal = normalize(vNormal);
+#ifdef NORMAL_MAP
+    vec3 tangent = normalize(vTangent - normal * dot(normal, vTangent));
+    vec3 bitangent = cross(normal, tangent) * (vBitangentSign < 0.0 ? -1.0 : 1.0);
+    vec3 mapped = texture2D(normalMap, vUV).xyz * 2.0 - 1.0;
+    normal = normalize(mat3(tangent, bitangent, normal) * mapped);
+#endif
 
     vec3 light1Dir = normalize(vec3(0.5, 1.0, 0.3));
-    float diff1 = max(dot(normalize(vNormal), light1Dir), 0.0);
+    float diff1 = max(dot(normal, light1Dir), 0.0);
 
     vec3 light2Dir = normalize(vec3(-0.5, -0.5, -0.5));
-    float diff2 = max(dot(normalize(vNormal), light2Dir), 0.0);
+    float diff2 = max(dot(normal, light2Dir), 0.0);
     
     float lightIntensity = diff1 * 0.8 + diff2 * 0.2;
     
     vec3 color = texColor * (0.4 + 0.6 * lightIntensity); 
 
+#ifdef SPECULAR_MAP
+    // Blinn-Phong dla głównego światła, siła odblasku z mapy
+    vec3 viewDir = normalize(CameraPos - vWorldPos);
+    vec3 halfDir = normalize(light1Dir + viewDir);
+    float spec = diff1 > 0.0 ? pow(max(dot(normal, halfDir), 0.0), 32.0) : 0.0;
+    color += texture2D(specularMap, vUV).rgb * spec;
+#endif
+#ifdef EMISSIVE_MAP
+    color += texture2D(emissiveMap, vUV).rgb;
+#endif
+    color = mix(color, vec3(1.0, 0.6, 0.1), Highlight * 0.35);
+
+#ifdef ALPHA_BLEND
+    gl_FragColor = vec4(color, texSample.a);
+#else
     gl_FragColor = vec4(color, 1.0);
+#endif
+}
+)";
+
+// Pre-pass głębokości: kolor i tak jest maskowany przez glColorMask
+const char* fsDepth = R"(
+precision mediump float;
+
+#ifdef ALPHA_MASK
+uniform sampler2D tex;
+varying vec2 vUV;
+#endif
+
+void main() {
+#ifdef ALPHA_MASK
+    if (texture2D(tex, vUV).a < 0.5) discard;
+#endif
+    gl_FragColor = vec4(0.0);
+}
+)";
+
+// Każde wywołanie shadera dodaje stałą porcję koloru (blending GL_ONE, GL_ONE),
+// więc jasność piksela odpowiada liczbie cieniowanych fragmentów.
+const char* fsOverdraw = R"(
+precision mediump float;
+
+void main() {
+    gl_FragColor = vec4(0.1, 0.05, 0.02, 1.0);
+}
+)";
+
+// Wersje dla backendu GLES3: warstwa tablicy tekstur jest atrybutem wierzchołka
+const char* vsArray = R"(#version 300 es
+in vec3 aPos;
+in vec3 aNormal;
+in vec2 aUV;
+in float aLayer;
+
+out vec3 vNormal;
+out vec2 vUV;
+flat out float vLayer;
+
+uniform mat4 MVP;
+uniform mat4 Model;
+
+invariant gl_Position;
+
+void main(){
+    gl_Position = MVP * vec4(aPos, 1.0);
+    vNormal = normalize(mat3(Model) * aNormal);
+    vUV = aUV;
+    vLayer = aLayer;
 }
 )";
 
-// --- Deklaracje i implementacje klas (bez zmian) ---
+const char* fsArray = R"(#version 300 es
+precision mediump float;
+precision mediump sampler2DArray;
+
+uniform sampler2DArray texArray;
+in vec3 vNormal;
+in vec2 vUV;
+flat in float vLayer;
+out vec4 fragColor;
+
+uniform float Highlight;
+
+void main() {
+    vec4 texel = texture(texArray, vec3(vUV, vLayer));
+#ifdef ALPHA_MASK
+    if (texel.a < 0.5) discard;
+#endif
+    vec3 texColor = texel.rgb;
+
+    vec3 light1Dir = normalize(vec3(0.5, 1.0, 0.3));
+    float diff1 = max(dot(normalize(vNormal), light1Dir), 0.0);
+
+    vec3 light2Dir = normalize(vec3(-0.5, -0.5, -0.5));
+    float diff2 = max(dot(normalize(vNormal), light2Dir), 0.0);
+
+    float lightIntensity = diff1 * 0.8 + diff2 * 0.2;
+
+    vec3 color = texColor * (0.4 + 0.6 * lightIntensity);
+    fragColor = vec4(mix(color, vec3(1.0, 0.6, 0.1), Highlight * 0.35), 1.0);
+}
+)";
+
+const char* fsArrayDepth = R"(#version 300 es
+precision mediump float;
+precision mediump sampler2DArray;
+
+uniform sampler2DArray texArray;
+in vec2 vUV;
+flat in float vLayer;
+out vec4 fragColor;
+
+void main() {
+#ifdef ALPHA_MASK
+    if (texture(texArray, vec3(vUV, vLayer)).a < 0.5) discard;
+#endif
+    fragColor = vec4(0.0);
+}
+)";
+
+// --- Deklaracje i implementacje klas ---
+// Sposób traktowania alfy tekstury, decyduje o przebiegu renderowania
+enum class AlphaMode {
+    Opaque,  // alfa ignorowana, kolejność dowolna
+    Mask,    // alfa 0/1 - discard w shaderze, zapis głębokości
+    Blend    // miękka alfa - sortowanie od tyłu, bez zapisu głębokości
+};
+
 struct Material {
     GLuint diffuse = 0;
     GLuint specular = 0;
     GLuint normal = 0;
     GLuint emissive = 0;
+    AlphaMode alphaMode = AlphaMode::Opaque;
 
-    void bind(GLuint program) const;
-    void cleanup();
+    void bind(GLuint program, unsigned features = 0) const;
+    void requestResidency(float screenPixels) const;
+    bool sameTextures(const Material& other) const;
+    unsigned shaderFeatures(bool hasTangents) const;
 };
 
+class TriangleBvh;
+
 class Mesh {
 public:
     GLuint vbo = 0, ibo = 0;
     size_t indexCount = 0;
     Material material;
+    GLuint textureArray = 0;  // GLES3: zamiast materiału, wierzchołki mają 9. składową - warstwę
+    bool hasTangents = false; // 9. składowa to 4 bajty stycznej (GL_BYTE, znormalizowane)
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    int node = 0;                      // węzeł grafu sceny, z którego bierzemy macierz świata
+    const glm::mat4* world = nullptr;  // ustawiane w buildQueues na bieżącą klatkę
+    bool ownsBuffers = true;           // kolejne instancje tego samego aiMesh dzielą VBO/IBO
+    int proxy = -1;                    // liść w Model::spatialIndex
+    std::shared_ptr<const TriangleBvh> bvh;  // trójkąty w przestrzeni lokalnej, wspólne dla instancji
 
-    void render(GLuint program);
+    void render(GLuint program, unsigned features = 0);
+    void renderGeometry(GLuint program);
+    unsigned shaderFeatures() const { return material.shaderFeatures(hasTangents); }
+    MemoryUsage memoryUsage() const;  // własne VBO/IBO i tekstury materiału
     void cleanup();
 };
 
+// Kolejki rysowania jednej klatki, podzielone według AlphaMode
+struct RenderQueues {
+    std::vector<Mesh*> layered;  // GLES3: nieprzezroczyste z tablicą tekstur
+    std::vector<Mesh*> opaque;
+    std::vector<Mesh*> masked;
+    std::vector<Mesh*> blended;
+};
+
+// Hierarchia węzłów z pliku (aiNode) w kolejności rodzic-przed-dzieckiem: parent[i] < i,
+// więc jedno przejście po tablicach przelicza macierze świata. Przeliczane są tylko
+// poddrzewa węzłów oznaczonych jako brudne.
+class SceneGraph {
+public:
+    struct Transform {
+        glm::vec3 translation = glm::vec3(0.0f);
+        glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+        glm::vec3 scale = glm::vec3(1.0f);
+    };
+
+    std::vector<int> parent;
+    std::vector<std::string> names;
+    std::vector<Transform> local;
+    std::vector<glm::mat4> world;
+    std::vector<unsigned char> changed;  // węzły przeliczone w ostatnim update(), który zwrócił true
+
+    int addNode(int parentIndex, const std::string& name, const Transform& transform);
+    void setLocal(int node, const Transform& transform);
+    bool update();
+    size_t size() const { return parent.size(); }
+    void clear();
+
+private:
+    std::vector<unsigned char> dirty;
+    bool anyDirty = false;
+};
+
+// --- Indeks przestrzenny: dynamiczne drzewo AABB ---
+struct Aabb {
+    glm::vec3 min = glm::vec3(1e30f);
+    glm::vec3 max = glm::vec3(-1e30f);
+
+    float surfaceArea() const {
+        glm::vec3 d = max - min;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+    bool contains(const Aabb& other) const {
+        return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+               max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+    }
+    bool contains(const glm::vec3& p) const {
+        return p.x >= min.x && p.y >= min.y && p.z >= min.z && p.x <= max.x && p.y <= max.y && p.z <= max.z;
+    }
+};
+
+inline Aabb mergeAabb(const Aabb& a, const Aabb& b) {
+    Aabb result;
+    result.min = glm::min(a.min, b.min);
+    result.max = glm::max(a.max, b.max);
+    return result;
+}
+
+// Wejście promienia w pudełko (metoda płyt); false, gdy nie trafia przed maxT
+inline bool rayHitsAabb(const Aabb& box, const glm::vec3& origin, const glm::vec3& invDir, float maxT, float& tEnter) {
+    float t0 = 0.0f, t1 = maxT;
+    for (int axis = 0; axis < 3; ++axis) {
+        float tNear = (box.min[axis] - origin[axis]) * invDir[axis];
+        float tFar = (box.max[axis] - origin[axis]) * invDir[axis];
+        if (tNear > tFar) std::swap(tNear, tFar);
+        t0 = std::max(t0, tNear);
+        t1 = std::min(t1, tFar);
+        if (t0 > t1) return false;
+    }
+    tEnter = t0;
+    return true;
+}
+
+// Płaszczyzny (xyz - normalna do wnętrza, w - odległość) z macierzy projekcja * widok
+void extractFrustumPlanes(const glm::mat4& m, glm::vec4 planes[6]) {
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+    planes[0] = row3 + row0;
+    planes[1] = row3 - row0;
+    planes[2] = row3 + row1;
+    planes[3] = row3 - row1;
+    planes[4] = row3 + row2;
+    planes[5] = row3 - row2;
+    for (int i = 0; i < 6; ++i) {
+        planes[i] = planes[i] * (1.0f / glm::length(glm::vec3(planes[i])));
+    }
+}
+
+// Drzewo z wstawianiem według kosztu powierzchni i rotacjami AVL (jak w Box2D), więc
+// wysokość rośnie logarytmicznie z liczbą obiektów. Liście trzymają powiększone pudełka -
+// przesunięty obiekt, który nie wyszedł poza swój margines, nie zmienia struktury drzewa.
+class AabbTree {
+public:
+    int insert(const Aabb& box, int userData);
+    void remove(int proxy);
+    bool move(int proxy, const Aabb& box);  // true, gdy liść trzeba było przenieść
+    void clear();
+    int height() const { return root < 0 ? 0 : nodes[root].height; }
+    size_t leafCount() const { return leaves; }
+
+    // visit(userData) dla każdego liścia przecinającego ostrosłup widzenia
+    template <typename Visit>
+    void queryFrustum(const glm::vec4 planes[6], Visit&& visit) const {
+        if (root < 0) return;
+        stack.clear();
+        stack.push_back(root);
+        while (!stack.empty()) {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+            bool inside = true;  // całe pudełko po wewnętrznej stronie wszystkich płaszczyzn
+            bool outside = false;
+            for (int i = 0; i < 6 && !outside; ++i) {
+                glm::vec3 n(planes[i]);
+                glm::vec3 positive(n.x >= 0 ? node.box.max.x : node.box.min.x, n.y >= 0 ? node.box.max.y : node.box.min.y,
+                                   n.z >= 0 ? node.box.max.z : node.box.min.z);
+                glm::vec3 negative(n.x >= 0 ? node.box.min.x : node.box.max.x, n.y >= 0 ? node.box.min.y : node.box.max.y,
+                                   n.z >= 0 ? node.box.min.z : node.box.max.z);
+                if (glm::dot(n, positive) + planes[i].w < 0.0f) outside = true;
+                if (glm::dot(n, negative) + planes[i].w < 0.0f) inside = false;
+            }
+            if (outside) continue;
+            if (node.isLeaf()) {
+                visit(node.userData);
+            } else if (inside) {
+                collectLeaves(node.left, visit);
+                collectLeaves(node.right, visit);
+            } else {
+                stack.push_back(node.left);
+                stack.push_back(node.right);
+            }
+        }
+    }
+
+    // visit(userData, tEnter) zwraca nowe maxT - krótsze przycina dalsze przeszukiwanie
+    template <typename Visit>
+    void raycast(const glm::vec3& origin, const glm::vec3& dir, float maxT, Visit&& visit) const {
+        if (root < 0) return;
+        glm::vec3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+        stack.clear();
+        stack.push_back(root);
+        while (!stack.empty()) {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+            float tEnter;
+            if (!rayHitsAabb(node.box, origin, invDir, maxT, tEnter)) continue;
+            if (node.isLeaf()) {
+                maxT = std::min(maxT, visit(node.userData, tEnter));
+            } else {
+                stack.push_back(node.left);
+                stack.push_back(node.right);
+            }
+        }
+    }
+
+private:
+    struct Node {
+        Aabb box;
+        int parent = -1;  // w wolnych węzłach: następny wolny
+        int left = -1, right = -1;
+        int height = 0;
+        int userData = -1;
+        bool isLeaf() const { return left < 0; }
+    };
+
+    template <typename Visit>
+    void collectLeaves(int index, Visit& visit) const {
+        const Node& node = nodes[index];
+        if (node.isLeaf()) {
+            visit(node.userData);
+            return;
+        }
+        collectLeaves(node.left, visit);
+        collectLeaves(node.right, visit);
+    }
+
+    int allocateNode();
+    void freeNode(int index);
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+    void refitUpwards(int index);
+    int balance(int index);
+
+    std::vector<Node> nodes;
+    mutable std::vector<int> stack;  // wspólny stos zapytań, bez alokacji co klatkę
+    int root = -1;
+    int freeList = -1;
+    size_t leaves = 0;
+    static constexpr float margin = 0.05f;
+};
+
+// Wynik wyboru promieniem: submesh i odległość wzdłuż promienia
+struct PickHit {
+    int mesh = -1;
+    float t = 0.0f;
+    unsigned int triangle = 0;  // numer trójkąta w buforze indeksów submesha
+    float u = 0.0f, v = 0.0f;   // współrzędne barycentryczne względem wierzchołków 1 i 2
+};
+
 class Model {
 public:
     std::vector<Mesh> meshes;
+    GLuint textureArray = 0;
+    bool textureArrayMasked = false;  // któraś warstwa ma alpha-test - rysowana wariantem z discard
+    SceneGraph graph;  // węzeł 0 to ustawienie modelu w świecie, pod nim hierarchia z pliku
+    AabbTree spatialIndex;  // liść na każdą instancję submesha, w przestrzeni świata
 
     Model() = default;
-    void load(const std::string& modelPath, const std::string& textureDir);
-    void render(GLuint program);
+    void load(Assimp::Importer& importer, const std::string& modelPath, const std::string& textureDir);
+    void updateTransforms();
+    void buildQueues(const glm::vec3& cameraPos, const glm::mat4& viewProjection, RenderQueues& queues);
+    bool pick(const glm::vec3& origin, const glm::vec3& dir, PickHit& hit) const;
+    float sweepCamera(const glm::vec3& target, const glm::vec3& dir, float armLength) const;
+    MemoryUsage memoryUsage() const;  // wspólne bufory i tekstury liczone raz
     void cleanup();
 };
 
-void Material::bind(GLuint program) const {
+// Wiąże tylko jednostki, z których korzysta wariant shadera (features), diffuse zawsze.
+// Samplery mają stałe jednostki ustawione w createProgram.
+void Material::bind(GLuint program, unsigned features) const {
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, diffuse);
-    glUniform1i(glGetUniformLocation(program, "tex"), 0);
 
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, specular);
-    glUniform1i(glGetUniformLocation(program, "specularMap"), 1);
+    if (features & SHADER_SPECULAR_MAP) {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, specular);
+    }
+
+    if (features & SHADER_NORMAL_MAP) {
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, normal);
+    }
 
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, normal);
-    glUniform1i(glGetUniformLocation(program, "normalMap"), 2);
+    if (features & SHADER_EMISSIVE_MAP) {
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_2D, emissive);
+    }
+}
 
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, emissive);
-    glUniform1i(glGetUniformLocation(program, "emissiveMap"), 3);
+// Sloty materiału -> bity wariantu; mapa normalnych bez stycznych w VBO jest pomijana
+unsigned Material::shaderFeatures(bool hasTangents) const {
+    unsigned features = 0;
+    if (alphaMode == AlphaMode::Mask) features |= SHADER_ALPHA_MASK;
+    if (alphaMode == AlphaMode::Blend) features |= SHADER_ALPHA_BLEND;
+    if (normal && hasTangents) features |= SHADER_NORMAL_MAP;
+    if (specular) features |= SHADER_SPECULAR_MAP;
+    if (emissive) features |= SHADER_EMISSIVE_MAP;
+    return features;
 }
 
-void Material::cleanup() {
-    if (diffuse) glDeleteTextures(1, &diffuse);
-    if (specular) glDeleteTextures(1, &specular);
-    if (normal) glDeleteTextures(1, &normal);
-    if (emissive) glDeleteTextures(1, &emissive);
+bool Material::sameTextures(const Material& other) const {
+    return diffuse == other.diffuse && specular == other.specular && normal == other.normal &&
+           emissive == other.emissive && alphaMode == other.alphaMode;
 }
 
-void Mesh::render(GLuint program) {
-    material.bind(program);
+void Mesh::render(GLuint program, unsigned features) {
+    if (textureArray) {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+    } else {
+        material.bind(program, features);
+    }
+    renderGeometry(program);
+}
 
+// Sama geometria, bez tekstur - dla pre-passu i widoku overdraw
+void Mesh::renderGeometry(GLuint program) {
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 
-    GLint posLoc = glGetAttribLocation(program, "aPos");
-    GLint normalLoc = glGetAttribLocation(program, "aNormal");
-    GLint uvLoc = glGetAttribLocation(program, "aUV");
+    // Lokalizacje są stałe (AttribLocation); atrybut, którego program nie używa, jest ignorowany
+    GLsizei stride = sizeof(float) * ((textureArray || hasTangents) ? 9 : 8);
+
+    glEnableVertexAttribArray(ATTR_POS);
+    glVertexAttribPointer(ATTR_POS, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
 
-    glEnableVertexAttribArray(posLoc);
-    glVertexAttribPointer(posLoc, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void*)0);
+    glEnableVertexAttribArray(ATTR_NORMAL);
+    glVertexAttribPointer(ATTR_NORMAL, 3, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * 3));
 
-    glEnableVertexAttribArray(normalLoc);
-    glVertexAttribPointer(normalLoc, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void*)(sizeof(float) * 3));
+    glEnableVertexAttribArray(ATTR_UV);
+    glVertexAttribPointer(ATTR_UV, 2, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * 6));
 
-    glEnableVertexAttribArray(uvLoc);
-    glVertexAttribPointer(uvLoc, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void*)(sizeof(float) * 6));
+    if (textureArray) {
+        glEnableVertexAttribArray(ATTR_LAYER);
+        glVertexAttribPointer(ATTR_LAYER, 1, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * 8));
+    }
+
+    if (hasTangents) {
+        glEnableVertexAttribArray(ATTR_TANGENT);
+        glVertexAttribPointer(ATTR_TANGENT, 4, GL_BYTE, GL_TRUE, stride, (void*)(sizeof(float) * 8));
+    }
 
     glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (void*)0);
+
+    if (textureArray) {
+        glDisableVertexAttribArray(ATTR_LAYER);
+    }
+    if (hasTangents) {
+        glDisableVertexAttribArray(ATTR_TANGENT);
+    }
+}
+
+MemoryUsage Mesh::memoryUsage() const {
+    MemoryUsage usage;
+    usage.vertexBytes = resourceTracker.bytes(GpuResource::VertexBuffer, vbo);
+    usage.indexBytes = resourceTracker.bytes(GpuResource::IndexBuffer, ibo);
+    for (GLuint tex : {material.diffuse, material.specular, material.normal, material.emissive}) {
+        if (tex) usage.textureBytes += resourceTracker.bytes(GpuResource::Texture, tex);
+    }
+    return usage;
 }
 
+// Tekstury materiału należą do textureCache
 void Mesh::cleanup() {
+    if (!ownsBuffers) return;
+    resourceTracker.release(GpuResource::VertexBuffer, vbo);
+    resourceTracker.release(GpuResource::IndexBuffer, ibo);
     glDeleteBuffers(1, &vbo);
     glDeleteBuffers(1, &ibo);
-    material.cleanup();
 }
 
 GLuint compileShader(GLenum type, const char* source) {
@@ -185,6 +896,108 @@ GLuint compileShader(GLenum type, const char* source) {
     return shader;
 }
 
+// Lokalizacje uniformów zmienianych co klatkę, pobierane raz po linkowaniu.
+// W WebGL każde glGetUniformLocation to wywołanie przez granicę JS.
+struct ProgramUniforms {
+    GLint mvp = -1;
+    GLint model = -1;
+    GLint cameraPos = -1;
+    GLint renderSize = -1;
+    GLint textureSize = -1;
+    GLint highlight = -1;
+};
+std::map<GLuint, ProgramUniforms> programUniforms;
+
+const ProgramUniforms& uniformsOf(GLuint program) {
+    return programUniforms[program];
+}
+
+void deleteProgram(GLuint program) {
+    programUniforms.erase(program);
+    glDeleteProgram(program);
+}
+
+// defines trafiają na początek źródła (np. "#define ALPHA_MASK\n"), a w shaderach
+// GLSL ES 3.00 zaraz za linią #version, która musi zostać pierwsza
+std::string withDefines(const char* source, const std::string& defines) {
+    std::string full = source;
+    if (full.compare(0, 8, "#version") != 0) return defines + full;
+    size_t lineEnd = full.find('\n') + 1;
+    return full.insert(lineEnd, defines);
+}
+
+GLuint createProgram(const char* vsSource, const char* fsSource, const std::string& defines = "") {
+    std::string vsFull = withDefines(vsSource, defines);
+    std::string fsFull = withDefines(fsSource, defines);
+    GLuint vsId = compileShader(GL_VERTEX_SHADER, vsFull.c_str());
+    GLuint fsId = compileShader(GL_FRAGMENT_SHADER, fsFull.c_str());
+    GLuint prog = glCreateProgram();
+    glAttachShader(prog, vsId);
+    glAttachShader(prog, fsId);
+
+    // Stałe lokalizacje atrybutów we wszystkich programach
+    glBindAttribLocation(prog, ATTR_POS, "aPos");
+    glBindAttribLocation(prog, ATTR_NORMAL, "aNormal");
+    glBindAttribLocation(prog, ATTR_UV, "aUV");
+    glBindAttribLocation(prog, ATTR_LAYER, "aLayer");
+    glBindAttribLocation(prog, ATTR_TANGENT, "aTangent");
+    glLinkProgram(prog);
+
+    GLint success;
+    glGetProgramiv(prog, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(prog, 512, nullptr, infoLog);
+        std::cerr << "Program link error: " << infoLog << "\n";
+    }
+
+    glDeleteShader(vsId);
+    glDeleteShader(fsId);
+
+    ProgramUniforms& uniforms = programUniforms[prog];
+    uniforms.mvp = glGetUniformLocation(prog, "MVP");
+    uniforms.model = glGetUniformLocation(prog, "Model");
+    uniforms.cameraPos = glGetUniformLocation(prog, "CameraPos");
+    uniforms.renderSize = glGetUniformLocation(prog, "renderSize");
+    uniforms.textureSize = glGetUniformLocation(prog, "textureSize");
+    uniforms.highlight = glGetUniformLocation(prog, "Highlight");
+
+    // Samplery nie zmieniają jednostek - ustawiane raz, lokalizacja -1 jest ignorowana
+    glUseProgram(prog);
+    glUniform1i(glGetUniformLocation(prog, "tex"), 0);
+    glUniform1i(glGetUniformLocation(prog, "specularMap"), 1);
+    glUniform1i(glGetUniformLocation(prog, "normalMap"), 2);
+    glUniform1i(glGetUniformLocation(prog, "emissiveMap"), 3);
+    glUniform1i(glGetUniformLocation(prog, "texArray"), 0);
+    glUniform1i(glGetUniformLocation(prog, "frame"), 0);
+    glUseProgram(0);
+    return prog;
+}
+
+GLuint shaderVariant(unsigned features) {
+    auto it = shaderVariants.find(features);
+    if (it != shaderVariants.end()) return it->second;
+
+    std::string defines;
+    if (features & SHADER_ALPHA_MASK) defines += "#define ALPHA_MASK\n";
+    if (features & SHADER_ALPHA_BLEND) defines += "#define ALPHA_BLEND\n";
+    if (features & SHADER_NORMAL_MAP) defines += "#define NORMAL_MAP\n";
+    if (features & SHADER_SPECULAR_MAP) defines += "#define SPECULAR_MAP\n";
+    if (features & SHADER_EMISSIVE_MAP) defines += "#define EMISSIVE_MAP\n";
+
+    GLuint prog = createProgram(vs, fs, defines);
+    shaderVariants[features] = prog;
+    std::cout << "Wariant shadera 0x" << std::hex << features << std::dec << " (" << shaderVariants.size() << " w cache)\n";
+    return prog;
+}
+
+void releaseShaderVariants() {
+    for (auto& entry : shaderVariants) {
+        deleteProgram(entry.second);
+    }
+    shaderVariants.clear();
+}
+
 void printAllMaterialTextures(aiMaterial* material) {
     std::vector<std::pair<aiTextureType, const char*>> textureTypes = {
         {aiTextureType_DIFFUSE, "DIFFUSE"},
@@ -212,128 +1025,3315 @@ void printAllMaterialTextures(aiMaterial* material) {
     }
 }
 
-GLuint loadTextureFromMaterial(aiMaterial* mat, aiTextureType type, const std::string& directory) {
-    if (mat->GetTextureCount(type) > 0) {
-        aiString path;
-        mat->GetTexture(type, 0, &path);
-        
-        std::string fullPath = std::string(path.C_Str());
-        std::cout << "Proba zaladowania tekstury: " << fullPath << "\n";
-
-        SDL_Surface* surface = IMG_Load(fullPath.c_str());
-        if (!surface) {
-            std::cerr << "Nie udalo sie zaladowac tekstury: " << fullPath << ", SDL_image Error: " << IMG_GetError() << "\n";
-            return 0;
+// Klasyfikacja alfy: pełna nieprzezroczystość, alfa 0/1 albo miękkie przejścia.
+// Kilka procent pikseli pośrednich (antyaliasowane krawędzie rzęs) to nadal alpha-test.
+AlphaMode classifyAlpha(const unsigned char* pixels, int width, int height, int channels) {
+    if (channels != 4) {
+        return AlphaMode::Opaque;
+    }
+
+    size_t transparent = 0, partial = 0;
+    size_t total = (size_t)width * height;
+    for (size_t i = 0; i < total; ++i) {
+        unsigned char a = pixels[i * 4 + 3];
+        if (a < 8) {
+            ++transparent;
+        } else if (a < 248) {
+            ++partial;
         }
-        std::cout << "Tekstura zaladowana: " << fullPath << "\n";
+    }
 
-        GLuint texID;
-        glGenTextures(1, &texID);
-        glBindTexture(GL_TEXTURE_2D, texID);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (transparent == 0 && partial == 0) return AlphaMode::Opaque;
+    if (partial * 20 < total) return AlphaMode::Mask;
+    return AlphaMode::Blend;
+}
 
-        GLenum format = (surface->format->BytesPerPixel == 4) ? GL_RGBA : GL_RGB;
-        glTexImage2D(GL_TEXTURE_2D, 0, format, surface->w, surface->h, 0, format, GL_UNSIGNED_BYTE, surface->pixels);
-        glGenerateMipmap(GL_TEXTURE_2D);
+// --- Skompresowane tekstury GPU (pliki .ktx przygotowane przez bake.cpp) ---
+// Kolejność = preferencja. ETC1 nie ma alfy, bake.cpp tworzy go tylko dla tekstur bez alfy.
+// RGBA to nieskompresowany wariant z gotowymi mipmapami - działa wszędzie.
+enum TextureCodec { CODEC_ASTC, CODEC_ETC2, CODEC_BC, CODEC_ETC1, CODEC_RGBA, CODEC_COUNT };
+const char* codecSuffix[CODEC_COUNT] = {"astc", "etc2", "bc", "etc1", "rgba"};
+bool codecSupported[CODEC_COUNT] = {false, false, false, false, true};
 
-        SDL_FreeSurface(surface);
-        return texID;
+// Nazwy rozszerzeń bieżącego kontekstu, bez prefiksu "GL_" - Emscripten zwraca nazwy
+// rozszerzeń WebGL zarówno z prefiksem, jak i bez
+std::set<std::string> glExtensions() {
+    std::set<std::string> extensions;
+    const char* extString = (const char*)glGetString(GL_EXTENSIONS);
+    std::istringstream tokens(extString ? extString : "");
+    std::string name;
+    while (tokens >> name) {
+        if (name.compare(0, 3, "GL_") == 0) name = name.substr(3);
+        extensions.insert(name);
     }
-    return 0;
+    return extensions;
 }
 
-Material loadMaterial(const aiScene* scene, const aiMesh* mesh, const std::string& directory) {
-    Material mat;
-    if (!scene->HasMaterials()) {
-        std::cerr << "Brak materialow w scenie.\n";
-        return mat;
+void detectCompressedFormats() {
+    std::set<std::string> extensions = glExtensions();
+    auto has = [&](const char* ext) { return extensions.count(ext) > 0; };
+
+    codecSupported[CODEC_ASTC] = has("KHR_texture_compression_astc_ldr") || has("WEBGL_compressed_texture_astc");
+    codecSupported[CODEC_ETC2] = has("WEBGL_compressed_texture_etc");
+    codecSupported[CODEC_BC] = has("EXT_texture_compression_s3tc") || has("WEBGL_compressed_texture_s3tc");
+    codecSupported[CODEC_ETC1] = has("OES_compressed_ETC1_RGB8_texture") || has("WEBGL_compressed_texture_etc1");
+
+#ifndef __EMSCRIPTEN__
+    // Natywne GLES 3.x ma ETC2 w rdzeniu (WebGL2 już nie)
+    const char* version = (const char*)glGetString(GL_VERSION);
+    if (version && std::string(version).find("OpenGL ES 3") != std::string::npos) {
+        codecSupported[CODEC_ETC2] = true;
     }
+#endif
 
-    aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-    printAllMaterialTextures(material);
-    
-    mat.diffuse = loadTextureFromMaterial(material, aiTextureType_DIFFUSE, directory);
+    std::cout << "Kompresja tekstur:";
+    for (int c = 0; c < CODEC_COUNT; ++c) {
+        std::cout << " " << codecSuffix[c] << (codecSupported[c] ? "=tak" : "=nie");
+    }
+    std::cout << "\n";
+}
 
-    return mat;
+bool isPowerOfTwo(int v) {
+    return v > 0 && (v & (v - 1)) == 0;
 }
 
-// --- Model (implementacja metod) ---
-void Model::load(const std::string& path, const std::string& textureDir) {
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_GenNormals | aiProcess_CalcTangentSpace);
+// Mipmapy są próbkowane tylko z filtrem *_MIPMAP_*; GLES2/WebGL1 nie pozwala
+// na mipmapy ani GL_REPEAT dla tekstur NPOT
+void setTextureSampling(int width, int height, bool hasMips) {
+    bool pot = isPowerOfTwo(width) && isPowerOfTwo(height);
+    GLint wrap = pot ? GL_REPEAT : GL_CLAMP_TO_EDGE;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (hasMips && pot) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+}
 
-    if (!scene || !scene->HasMeshes()) {
-        std::cerr << "Nie udalo sie zaladowac modelu: " << importer.GetErrorString() << "\n";
-        return;
+// --- Zasoby: manifest, pobieranie na żądanie, mapowanie plików ---
+// bake.cpp --manifest zapisuje asserts/manifest.txt (ścieżka, rozmiar, skrót FNV-1a treści).
+// Do paczki startowej trafia tylko manifest; resztę plików pobiera AssetStore:
+// w przeglądarce asynchronicznie przez emscripten_fetch z trwałą pamięcią podręczną
+// (IndexedDB, adres z ?v=skrót, więc zmieniony plik omija starą kopię), a pobrane bajty
+// zapisuje w MEMFS pod oryginalną ścieżką. Natywnie pliki leżą na dysku i są mapowane (mmap).
+uint64_t fnv1a64(const unsigned char* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ull;
     }
+    return hash;
+}
 
-    for (unsigned int i = 0; i < scene->mNumMeshes; ++i) {
-        const aiMesh* mesh = scene->mMeshes[i];
-        Mesh newMesh;
+struct AssetEntry {
+    size_t size = 0;
+    uint64_t hash = 0;
+    std::string source;  // plik do pobrania: ten sam albo pierwszy o identycznej treści
+};
 
-        std::vector<float> vertices;
-        std::vector<unsigned int> indices;
+class AssetStore {
+public:
+    bool loadManifest(const std::string& path);
+    bool hasManifest() const { return !entries.empty(); }
+    const AssetEntry* find(const std::string& path) const;
+    bool contains(const std::string& path) const { return find(path) != nullptr; }
 
-        for (unsigned int j = 0; j < mesh->mNumVertices; ++j) {
-            vertices.push_back(mesh->mVertices[j].x);
-            vertices.push_back(mesh->mVertices[j].y);
-            vertices.push_back(mesh->mVertices[j].z);
-
-            if (mesh->HasNormals()) {
-                vertices.push_back(mesh->mNormals[j].x);
-                vertices.push_back(mesh->mNormals[j].y);
-                vertices.push_back(mesh->mNormals[j].z);
-            } else {
-                vertices.insert(vertices.end(), {0.0f, 0.0f, 0.0f});
-            }
+    // Pobiera brakujące pliki; ready() mówi, kiedy wszystkie są w systemie plików
+    void fetch(const std::vector<std::string>& paths);
+    bool ready() const { return pending == 0; }
+    int failedCount() const { return failed; }
 
-            if (mesh->HasTextureCoords(0)) {
-                vertices.push_back(mesh->mTextureCoords[0][j].x);
-                vertices.push_back(mesh->mTextureCoords[0][j].y);
-            } else {
-                vertices.insert(vertices.end(), {0.0f, 0.0f});
-            }
-        }
+private:
+    std::map<std::string, AssetEntry> entries;
+    int pending = 0;
+    int failed = 0;
+    size_t fetchedBytes = 0;
 
-        for (unsigned int j = 0; j < mesh->mNumFaces; ++j) {
-            const aiFace& face = mesh->mFaces[j];
-            for (unsigned int k = 0; k < face.mNumIndices; ++k) {
-                indices.push_back(face.mIndices[k]);
-            }
-        }
+#ifdef __EMSCRIPTEN__
+    struct Request {
+        AssetStore* store;
+        std::string path;
+        AssetEntry entry;
+    };
+    static void onFetched(emscripten_fetch_t* fetch);
+    static void onFetchFailed(emscripten_fetch_t* fetch);
+    void finish(Request* request, const unsigned char* data, size_t size);
+#endif
+};
 
-        glGenBuffers(1, &newMesh.vbo);
+AssetStore assetStore;
+
+bool diskFileExists(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+bool AssetStore::loadManifest(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Brak manifestu zasobow: " << path << " (pliki tylko z dysku)\n";
+        return false;
+    }
+    std::string line;
+    size_t totalBytes = 0, duplicates = 0;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string name, hashHex, original;
+        AssetEntry entry;
+        if (!(fields >> name >> entry.size >> hashHex)) continue;
+        entry.hash = std::strtoull(hashHex.c_str(), nullptr, 16);
+        entry.source = name;
+        if (fields >> original && original.size() > 1 && original[0] == '=') {
+            entry.source = original.substr(1);
+            ++duplicates;
+        }
+        totalBytes += entry.size;
+        entries[name] = entry;
+    }
+    std::cout << "Manifest zasobow: " << entries.size() << " plikow, " << totalBytes / 1024 << " KB, "
+              << duplicates << " duplikatow\n";
+    return true;
+}
+
+const AssetEntry* AssetStore::find(const std::string& path) const {
+    auto it = entries.find(path);
+    return it == entries.end() ? nullptr : &it->second;
+}
+
+void AssetStore::fetch(const std::vector<std::string>& paths) {
+    size_t requestedBytes = 0;
+    for (const std::string& path : paths) {
+        if (diskFileExists(path)) continue;  // natywnie zawsze, w przeglądarce jeśli już pobrany
+        const AssetEntry* entry = find(path);
+        if (!entry) {
+            std::cerr << "Brak pliku w manifescie: " << path << "\n";
+            ++failed;
+            continue;
+        }
+        requestedBytes += entry->size;
+#ifdef __EMSCRIPTEN__
+        emscripten_fetch_attr_t attr;
+        emscripten_fetch_attr_init(&attr);
+        strcpy(attr.requestMethod, "GET");
+        attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY | EMSCRIPTEN_FETCH_PERSIST_FILE;
+        attr.onsuccess = onFetched;
+        attr.onerror = onFetchFailed;
+        attr.userData = new Request{this, path, *entry};
+        char version[17];
+        snprintf(version, sizeof(version), "%016llx", (unsigned long long)entry->hash);
+        std::string url = entry->source + "?v=" + version;
+        ++pending;
+        emscripten_fetch(&attr, url.c_str());
+#else
+        std::cerr << "Brak pliku na dysku: " << path << "\n";
+        ++failed;
+#endif
+    }
+    std::cout << "Zasoby do pobrania: " << pending << " plikow, " << requestedBytes / 1024 << " KB\n";
+}
+
+#ifdef __EMSCRIPTEN__
+void AssetStore::onFetched(emscripten_fetch_t* fetch) {
+    Request* request = (Request*)fetch->userData;
+    request->store->finish(request, (const unsigned char*)fetch->data, (size_t)fetch->numBytes);
+    emscripten_fetch_close(fetch);
+}
+
+void AssetStore::onFetchFailed(emscripten_fetch_t* fetch) {
+    Request* request = (Request*)fetch->userData;
+    std::cerr << "Nie udalo sie pobrac: " << request->entry.source << " (HTTP " << fetch->status << ")\n";
+    request->store->finish(request, nullptr, 0);
+    emscripten_fetch_close(fetch);
+}
+
+void AssetStore::finish(Request* request, const unsigned char* data, size_t size) {
+    --pending;
+    if (data && (size != request->entry.size || fnv1a64(data, size) != request->entry.hash)) {
+        std::cerr << "Pobrany plik nie zgadza sie z manifestem: " << request->path << "\n";
+        data = nullptr;
+    }
+    if (data) {
+        // Katalogi pośrednie w MEMFS, np. asserts/Harpy/
+        for (size_t slash = request->path.find('/'); slash != std::string::npos;
+             slash = request->path.find('/', slash + 1)) {
+            mkdir(request->path.substr(0, slash).c_str(), 0755);
+        }
+        std::ofstream out(request->path, std::ios::binary);
+        out.write((const char*)data, (std::streamsize)size);
+        fetchedBytes += size;
+    } else {
+        ++failed;
+    }
+    if (pending == 0) {
+        std::cout << "Zasoby pobrane: " << fetchedBytes / 1024 << " KB, bledow: " << failed << "\n";
+    }
+    delete request;
+}
+#endif
+
+// Plik zmapowany tylko do odczytu. Dekoder i upload czytają wprost ze stron pliku,
+// bez kopiowania do bufora; w przeglądarce mmap z MEMFS daje kopię w pamięci.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path) { open(path); }
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* mapped = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                bytes = (const unsigned char*)mapped;
+                length = (size_t)st.st_size;
+            }
+        }
+        ::close(fd);
+        return bytes != nullptr;
+    }
+
+    void close() {
+        if (bytes) munmap((void*)bytes, length);
+        bytes = nullptr;
+        length = 0;
+    }
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+    explicit operator bool() const { return bytes != nullptr; }
+
+private:
+    const unsigned char* bytes = nullptr;
+    size_t length = 0;
+};
+
+// Z manifestem plik "istnieje", jeśli da się go pobrać - wtedy wybór wariantu KTX
+// nie zależy od tego, czy plik już jest w MEMFS
+bool fileExists(const std::string& path) {
+    return assetStore.contains(path) || diskFileExists(path);
+}
+
+// Pierwsza część plików startowych: model, a dla GLES2 także opis atlasu. Tekstury wybiera
+// modelTextureAssets z materiałów modelu, gdy FBX jest już w systemie plików.
+std::vector<std::string> startupAssets(const std::string& modelPath, const std::string& directory) {
+    std::vector<std::string> paths = {modelPath};
+    if (renderBackend != RenderBackend::GLES3 && assetStore.contains(directory + "/atlas.txt")) {
+        paths.push_back(directory + "/atlas.txt");
+    }
+    return paths;
+}
+
+// Ścieżka z FBX bywa absolutna (z maszyny autora) - wtedy szukamy samej nazwy w katalogu tekstur
+std::string resolveTexturePath(const std::string& path, const std::string& directory) {
+    if (fileExists(path)) return path;
+    size_t slash = path.find_last_of("/\\");
+    std::string fileName = (slash == std::string::npos) ? path : path.substr(slash + 1);
+    return directory + "/" + fileName;
+}
+
+AlphaMode parseAlphaMode(const std::string& name) {
+    if (name == "mask") return AlphaMode::Mask;
+    if (name == "blend") return AlphaMode::Blend;
+    return AlphaMode::Opaque;
+}
+
+// Opis pliku KTX 1.1 bez danych obrazu - tylko położenie poziomów mipmap w pliku
+struct KtxInfo {
+    std::string path;
+    GLenum glType = 0;
+    GLenum glFormat = 0;
+    GLenum internalFormat = 0;
+    int width = 0;
+    int height = 0;
+    std::vector<size_t> levelOffset;
+    std::vector<uint32_t> levelSize;
+};
+
+bool readKtxInfo(const std::string& path, KtxInfo& info, AlphaMode* alphaOut) {
+    MappedFile f(path);
+    unsigned char ident[12];
+    uint32_t header[13];
+    if (f.size() < 64) return false;
+    memcpy(ident, f.data(), 12);
+    memcpy(header, f.data() + 12, sizeof(header));
+
+    const unsigned char identifier[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+    if (memcmp(ident, identifier, 12) != 0) {
+        std::cerr << "Niepoprawny plik KTX: " << path << "\n";
+        return false;
+    }
+    if (header[0] != 0x04030201) {
+        std::cerr << "KTX z inna kolejnoscia bajtow: " << path << "\n";
+        return false;
+    }
+    info.path = path;
+    info.glType = header[1];
+    info.glFormat = header[3];
+    info.internalFormat = header[4];
+    info.width = (int)header[6];
+    info.height = (int)header[7];
+    uint32_t levels = std::max(1u, header[11]);
+    uint32_t kvBytes = header[12];
+
+    // Pary klucz-wartość: interesuje nas tylko "alphaMode"
+    if (64 + (size_t)kvBytes > f.size()) return false;
+    const char* kv = (const char*)f.data() + 64;
+    size_t offset = 0;
+    while (offset + 4 <= kvBytes) {
+        uint32_t pairSize;
+        memcpy(&pairSize, kv + offset, 4);
+        if (offset + 4 + pairSize > kvBytes) break;
+        // Klucz i wartość kończą się zerem tylko wtedy, gdy plik jest poprawny - porównania
+        // nie wychodzą poza pairSize
+        const char* key = kv + offset + 4;
+        size_t keyLen = strnlen(key, pairSize);
+        if (alphaOut && keyLen == 9 && memcmp(key, "alphaMode", 9) == 0 && keyLen + 1 < pairSize) {
+            const char* value = key + keyLen + 1;
+            *alphaOut = parseAlphaMode(std::string(value, strnlen(value, pairSize - keyLen - 1)));
+        }
+        offset += 4 + ((pairSize + 3) & ~3u);
+    }
+
+    size_t filePos = 64 + kvBytes;
+    for (uint32_t level = 0; level < levels; ++level) {
+        uint32_t imageSize;
+        if (filePos + 4 > f.size()) {
+            std::cerr << "Uciety plik KTX: " << path << "\n";
+            break;
+        }
+        memcpy(&imageSize, f.data() + filePos, 4);
+        info.levelOffset.push_back(filePos + 4);
+        info.levelSize.push_back(imageSize);
+        filePos += 4 + ((imageSize + 3) & ~3u);
+    }
+    return !info.levelSize.empty();
+}
+
+// Wysyła poziomy od firstLevel do końca łańcucha. GLES2 nie ma GL_TEXTURE_BASE_LEVEL,
+// więc poziom firstLevel z pliku staje się poziomem 0 tekstury. Zwraca liczbę bajtów.
+size_t uploadKtxLevels(const KtxInfo& info, GLuint texID, int firstLevel) {
+    MappedFile f(info.path);
+    if (!f) return 0;
+
+    int levelCount = (int)info.levelSize.size();
+    glBindTexture(GL_TEXTURE_2D, texID);
+    setTextureSampling(std::max(1, info.width >> firstLevel), std::max(1, info.height >> firstLevel), levelCount - firstLevel > 1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    size_t totalSize = 0;
+    for (int level = firstLevel; level < levelCount; ++level) {
+        size_t levelSize = info.levelSize[level];
+        if (info.levelOffset[level] + levelSize > f.size()) {
+            std::cerr << "Uciety plik KTX: " << info.path << "\n";
+            break;
+        }
+        const unsigned char* data = f.data() + info.levelOffset[level];
+
+        int w = std::max(1, info.width >> level);
+        int h = std::max(1, info.height >> level);
+        int target = level - firstLevel;
+        if (info.glType == 0) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, target, info.internalFormat, w, h, 0, (GLsizei)levelSize, data);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, target, info.glFormat, w, h, 0, info.glFormat, info.glType, data);
+        }
+        totalSize += levelSize;
+    }
+    resourceTracker.record(GpuResource::Texture, texID, totalSize);
+    return totalSize;
+}
+
+// --- Strumieniowanie tekstur ---
+// Na starcie każda tekstura ma tylko małe mipmapy. Co klatkę render() zgłasza, ilu pikseli
+// na ekranie potrzebuje każda tekstura (rzut sfery otaczającej submesh). update() dokłada
+// dokładniejsze poziomy w ramach budżetu, a przy braku miejsca zrzuca najdawniej używane
+// tekstury z powrotem do poziomu startowego (LRU).
+class TextureStreamer {
+public:
+    size_t budgetBytes = 64 * 1024 * 1024;
+    int maxUploadsPerFrame = 2;   // ogranicza przycięcia klatki przy dużych poziomach
+    int initialMaxSize = 64;      // startowa rozdzielczość (najdłuższy bok)
+
+    GLuint add(const std::string& ktxPath, AlphaMode* alphaOut);
+    void request(GLuint texID, float screenPixels);
+    bool update();  // true, gdy zmieniła się rozdzielczość którejś tekstury
+    void report() const;
+    void clear();
+    size_t residentBytes() const { return totalBytes; }
+
+private:
+    struct Entry {
+        KtxInfo info;
+        GLuint id = 0;
+        int baseLevel = 0;     // poziom startowy - nigdy nie schodzimy poniżej
+        int resident = 0;      // pierwszy załadowany poziom (0 = pełna rozdzielczość)
+        int wanted = 0;        // najdokładniejszy poziom zgłoszony w tej klatce
+        uint64_t lastUsed = 0;
+        size_t bytes = 0;
+    };
+
+    std::vector<Entry> entries;
+    uint64_t frame = 1;
+    size_t totalBytes = 0;
+
+    Entry* find(GLuint texID);
+    size_t bytesFrom(const Entry& e, int level) const;
+    void setResidency(Entry& e, int level);
+    bool evictOne(const Entry* keep);
+};
+
+TextureStreamer textureStreamer;
+
+GLuint TextureStreamer::add(const std::string& ktxPath, AlphaMode* alphaOut) {
+    Entry e;
+    if (!readKtxInfo(ktxPath, e.info, alphaOut)) return 0;
+
+    int levelCount = (int)e.info.levelSize.size();
+    e.baseLevel = 0;
+    while (e.baseLevel + 1 < levelCount &&
+           std::max(e.info.width, e.info.height) >> e.baseLevel > initialMaxSize) {
+        ++e.baseLevel;
+    }
+
+    glGenTextures(1, &e.id);
+    e.bytes = uploadKtxLevels(e.info, e.id, e.baseLevel);
+    e.resident = e.baseLevel;
+    e.wanted = e.baseLevel;
+    totalBytes += e.bytes;
+
+    std::cout << "Tekstura KTX zaladowana: " << ktxPath << " (start " << (e.info.width >> e.baseLevel) << "x"
+              << (e.info.height >> e.baseLevel) << ", " << e.bytes / 1024 << " KB)\n";
+    entries.push_back(e);
+    return e.id;
+}
+
+TextureStreamer::Entry* TextureStreamer::find(GLuint texID) {
+    for (auto& e : entries) {
+        if (e.id == texID) return &e;
+    }
+    return nullptr;
+}
+
+void TextureStreamer::request(GLuint texID, float screenPixels) {
+    Entry* e = find(texID);
+    if (!e) return; // tekstura spoza streamera (np. PNG)
+
+    // Najmniejszy poziom, którego szerokość wciąż pokrywa piksele na ekranie
+    int level = 0;
+    int levelCount = (int)e->info.levelSize.size();
+    while (level + 1 < levelCount && (float)(std::max(e->info.width, e->info.height) >> (level + 1)) >= screenPixels) {
+        ++level;
+    }
+    e->wanted = std::min(e->wanted, level);
+    e->lastUsed = frame;
+}
+
+size_t TextureStreamer::bytesFrom(const Entry& e, int level) const {
+    size_t bytes = 0;
+    for (size_t l = level; l < e.info.levelSize.size(); ++l) {
+        bytes += e.info.levelSize[l];
+    }
+    return bytes;
+}
+
+void TextureStreamer::setResidency(Entry& e, int level) {
+    totalBytes -= e.bytes;
+    e.bytes = uploadKtxLevels(e.info, e.id, level);
+    e.resident = level;
+    totalBytes += e.bytes;
+}
+
+// Zrzuca do poziomu startowego najdawniej używaną teksturę, której nie było w tej klatce
+bool TextureStreamer::evictOne(const Entry* keep) {
+    Entry* victim = nullptr;
+    for (auto& e : entries) {
+        if (&e == keep || e.resident >= e.baseLevel || e.lastUsed == frame) continue;
+        if (!victim || e.lastUsed < victim->lastUsed) victim = &e;
+    }
+    if (!victim) return false;
+    setResidency(*victim, victim->baseLevel);
+    return true;
+}
+
+bool TextureStreamer::update() {
+    // Najpierw tekstury, którym brakuje najwięcej poziomów
+    std::vector<Entry*> pending;
+    for (auto& e : entries) {
+        if (e.wanted < e.resident) pending.push_back(&e);
+    }
+    std::sort(pending.begin(), pending.end(),
+              [](const Entry* a, const Entry* b) { return a->resident - a->wanted > b->resident - b->wanted; });
+
+    int uploads = 0;
+    bool changed = false;
+    for (Entry* e : pending) {
+        if (uploads >= maxUploadsPerFrame) break;
+
+        int target = e->wanted;
+        while (totalBytes - e->bytes + bytesFrom(*e, target) > budgetBytes && evictOne(e)) {
+            changed = true;
+        }
+        // Wciąż za mało miejsca - bierzemy tyle szczegółów, ile się mieści
+        while (target < e->resident && totalBytes - e->bytes + bytesFrom(*e, target) > budgetBytes) {
+            ++target;
+        }
+        if (target < e->resident) {
+            setResidency(*e, target);
+            ++uploads;
+            changed = true;
+        }
+    }
+
+    for (auto& e : entries) {
+        e.wanted = e.baseLevel;
+    }
+    ++frame;
+
+    if (changed) {
+        report();
+    }
+    return changed;
+}
+
+void TextureStreamer::report() const {
+    std::cout << "Tekstury w pamieci GPU: " << totalBytes / 1024 << " KB / budzet " << budgetBytes / 1024
+              << " KB (" << entries.size() << " tekstur)\n";
+}
+
+void TextureStreamer::clear() {
+    // Same tekstury GL usuwa releaseTextureCache
+    entries.clear();
+    totalBytes = 0;
+}
+
+void Material::requestResidency(float screenPixels) const {
+    for (GLuint tex : {diffuse, specular, normal, emissive}) {
+        if (tex) textureStreamer.request(tex, screenPixels);
+    }
+}
+
+// Najlepszy obsługiwany wariant KTX dla nazwy bazowej, np. asserts/Skin -> asserts/Skin.astc.ktx
+GLuint loadCompressedVariant(const std::string& base, AlphaMode* alphaOut) {
+    for (int c = 0; c < CODEC_COUNT; ++c) {
+        if (!codecSupported[c]) continue;
+        std::string ktxPath = base + "." + codecSuffix[c] + ".ktx";
+        if (!fileExists(ktxPath)) continue;
+
+        GLuint tex = textureStreamer.add(ktxPath, alphaOut);
+        if (tex) return tex;
+    }
+    return 0;
+}
+
+// Wariant obok pliku PNG, np. Skin.png -> Skin.astc.ktx
+GLuint loadCompressedTexture(const std::string& pngPath, AlphaMode* alphaOut) {
+    size_t dot = pngPath.find_last_of('.');
+    return loadCompressedVariant((dot == std::string::npos) ? pngPath : pngPath.substr(0, dot), alphaOut);
+}
+
+// --- Dekodowanie obrazów ---
+// Bloki w klasach potęg dwójki z 16-bajtowym nagłówkiem (numer klasy), więc piksele są
+// wyrównane do 16 B. Zwolniony blok wraca na listę swojej klasy i następna tekstura
+// tej samej wielkości (oraz bufory zlib wewnątrz stb_image) nie alokuje ponownie.
+// Z puli korzystają równolegle zadania ładowania, więc listy są chronione mutexem.
+struct StagingPool {
+    static const int minClass = 12;  // 4 KB
+    static const int classCount = 40;
+    std::mutex lock;
+    std::vector<void*> freeBlocks[classCount];
+    size_t allocations = 0;
+    size_t reuses = 0;
+};
+
+StagingPool stagingPool;
+
+void* stagingAlloc(size_t size) {
+    int cls = StagingPool::minClass;
+    while (cls < StagingPool::classCount && ((size_t)1 << cls) < size) ++cls;
+    if (cls >= StagingPool::classCount) return nullptr;
+
+    std::lock_guard<std::mutex> guard(stagingPool.lock);
+    unsigned char* block;
+    if (!stagingPool.freeBlocks[cls].empty()) {
+        block = (unsigned char*)stagingPool.freeBlocks[cls].back();
+        stagingPool.freeBlocks[cls].pop_back();
+        ++stagingPool.reuses;
+    } else {
+        block = (unsigned char*)aligned_alloc(16, 16 + ((size_t)1 << cls));
+        if (!block) return nullptr;
+        countHeapAlloc(block);
+        ++stagingPool.allocations;
+    }
+    *(int*)block = cls;
+    return block + 16;
+}
+
+void stagingFree(void* ptr) {
+    if (!ptr) return;
+    unsigned char* block = (unsigned char*)ptr - 16;
+    int cls = *(int*)block;
+    if (cls < StagingPool::minClass || cls >= StagingPool::classCount) {
+        std::cerr << "stagingFree: uszkodzony naglowek bloku (klasa " << cls << ")\n";
+        return;
+    }
+    std::lock_guard<std::mutex> guard(stagingPool.lock);
+    stagingPool.freeBlocks[cls].push_back(block);
+}
+
+void* stagingRealloc(void* ptr, size_t size) {
+    if (!ptr) return stagingAlloc(size);
+    size_t capacity = (size_t)1 << *(int*)((unsigned char*)ptr - 16);
+    if (size <= capacity) return ptr;
+
+    void* grown = stagingAlloc(size);
+    if (grown) {
+        memcpy(grown, ptr, capacity);
+        stagingFree(ptr);
+    }
+    return grown;
+}
+
+// Po załadowaniu sceny pula nie jest już potrzebna
+void releaseStagingPool() {
+    std::lock_guard<std::mutex> guard(stagingPool.lock);
+    size_t blocks = 0;
+    for (auto& list : stagingPool.freeBlocks) {
+        blocks += list.size();
+        for (void* block : list) {
+            countHeapFree(block);
+            free(block);
+        }
+        list.clear();
+    }
+    std::cout << "Pula dekodowania: " << stagingPool.allocations << " alokacji, " << stagingPool.reuses
+              << " ponownych uzyc, zwolniono " << blocks << " blokow\n";
+    stagingPool.allocations = 0;
+    stagingPool.reuses = 0;
+}
+
+struct DecodedImage {
+    unsigned char* pixels = nullptr;  // wiersze bez paddingu, kanały w kolejności R, G, B(, A)
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+};
+
+bool decodeImage(const std::string& path, DecodedImage& image) {
+    MappedFile file(path);
+    if (!file) {
+        std::cerr << "Nie udalo sie otworzyc: " << path << "\n";
+        return false;
+    }
+    // Bez wymuszania kanałów: RGB zostaje RGB, bez rozszerzania do RGBA
+    image.pixels = stbi_load_from_memory(file.data(), (int)file.size(),
+                                         &image.width, &image.height, &image.channels, 0);
+    if (!image.pixels) {
+        std::cerr << "Nie udalo sie zdekodowac: " << path << " (" << stbi_failure_reason() << ")\n";
+        return false;
+    }
+    if (image.channels != 3 && image.channels != 4) {
+        // Szarości rozszerzamy do RGBA, żeby upload miał zawsze format GL_RGB/GL_RGBA
+        stbi_image_free(image.pixels);
+        image.pixels = stbi_load_from_memory(file.data(), (int)file.size(),
+                                             &image.width, &image.height, &image.channels, 4);
+        image.channels = 4;
+    }
+    return image.pixels != nullptr;
+}
+
+void freeDecodedImage(DecodedImage& image) {
+    stbi_image_free(image.pixels);
+    image.pixels = nullptr;
+}
+
+// Wiersz RGB ma 3*width bajtów - domyślne wyrównanie 4 psułoby tekstury o nieparzystej szerokości
+void setUnpackAlignment(int width, int channels) {
+    size_t rowBytes = (size_t)width * channels;
+    GLint alignment = (rowBytes % 8 == 0) ? 8 : (rowBytes % 4 == 0) ? 4 : (rowBytes % 2 == 0) ? 2 : 1;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+}
+
+// --- Cache tekstur ---
+// Strony atlasu i tekstury współdzielone przez kilka materiałów ładujemy raz.
+// Cache jest właścicielem obiektów GL, materiały tylko je wskazują.
+struct CachedTexture {
+    GLuint id = 0;
+    AlphaMode alphaMode = AlphaMode::Opaque;
+};
+
+std::map<std::string, CachedTexture> textureCache;
+
+GLuint loadTextureFile(const std::string& fullPath, AlphaMode* alphaOut) {
+    auto cached = textureCache.find(fullPath);
+    if (cached != textureCache.end()) {
+        if (alphaOut) *alphaOut = cached->second.alphaMode;
+        return cached->second.id;
+    }
+
+    std::cout << "Proba zaladowania tekstury: " << fullPath << "\n";
+    CachedTexture entry;
+
+    entry.id = loadCompressedTexture(fullPath, &entry.alphaMode);
+    if (!entry.id) {
+        DecodedImage image;
+        if (!decodeImage(fullPath, image)) {
+            std::cerr << "Nie udalo sie zaladowac tekstury: " << fullPath << "\n";
+            return 0;
+        }
+        std::cout << "Tekstura zaladowana: " << fullPath << "\n";
+
+        entry.alphaMode = classifyAlpha(image.pixels, image.width, image.height, image.channels);
+
+        // Brak plików z bake.cpp - mipmapy liczone w czasie ładowania
+        glGenTextures(1, &entry.id);
+        glBindTexture(GL_TEXTURE_2D, entry.id);
+        bool canMip = isPowerOfTwo(image.width) && isPowerOfTwo(image.height);
+        setTextureSampling(image.width, image.height, canMip);
+
+        GLenum format = (image.channels == 4) ? GL_RGBA : GL_RGB;
+        setUnpackAlignment(image.width, image.channels);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels);
+        if (canMip) {
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+        resourceTracker.record(GpuResource::Texture, entry.id,
+                               mipChainBytes(image.width, image.height, image.channels == 4 ? 4 : 3, canMip));
+
+        freeDecodedImage(image);
+    }
+
+    textureCache[fullPath] = entry;
+    if (alphaOut) *alphaOut = entry.alphaMode;
+    return entry.id;
+}
+
+// Strony atlasu istnieją tylko jako KTX (bake nie zapisuje ich PNG), klucz cache to nazwa bazowa
+GLuint loadAtlasPage(const std::string& base, AlphaMode* alphaOut) {
+    auto cached = textureCache.find(base);
+    if (cached != textureCache.end()) {
+        if (alphaOut) *alphaOut = cached->second.alphaMode;
+        return cached->second.id;
+    }
+
+    CachedTexture entry;
+    entry.id = loadCompressedVariant(base, &entry.alphaMode);
+    if (!entry.id) {
+        std::cerr << "Strona atlasu bez obslugiwanego wariantu KTX: " << base << "\n";
+        return 0;
+    }
+    textureCache[base] = entry;
+    if (alphaOut) *alphaOut = entry.alphaMode;
+    return entry.id;
+}
+
+void releaseTextureCache() {
+    for (auto& entry : textureCache) {
+        resourceTracker.release(GpuResource::Texture, entry.second.id);
+        glDeleteTextures(1, &entry.second.id);
+    }
+    textureCache.clear();
+}
+
+// --- Atlas tekstur ---
+// atlas.txt z bake --atlas: "nazwa.png atlasN u0 v0 u1 v1", strona to pliki atlasN.<kodek>.ktx
+struct AtlasRegion {
+    std::string page;
+    float u0, v0, u1, v1;
+};
+
+std::map<std::string, AtlasRegion> loadAtlasManifest(const std::string& directory) {
+    std::map<std::string, AtlasRegion> regions;
+    std::ifstream file(directory + "/atlas.txt");
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream ss(line);
+        std::string name;
+        AtlasRegion region;
+        if (ss >> name >> region.page >> region.u0 >> region.v0 >> region.u1 >> region.v1) {
+            regions[name] = region;
+        }
+    }
+    if (!regions.empty()) {
+        std::cout << "Atlas: " << regions.size() << " tekstur w " << directory << "/atlas.txt\n";
+    }
+    return regions;
+}
+
+// Atlas nie powtarza tekstury, więc remapujemy tylko UV mieszczące się w [0,1]
+bool uvsInUnitRange(const float* vertices, size_t vertexCount) {
+    for (size_t i = 6; i < vertexCount * 8; i += 8) {
+        float u = vertices[i], v = vertices[i + 1];
+        if (u < 0.0f || u > 1.0f || v < 0.0f || v > 1.0f) return false;
+    }
+    return true;
+}
+
+void remapUVs(float* vertices, size_t vertexCount, const AtlasRegion& region) {
+    for (size_t i = 6; i < vertexCount * 8; i += 8) {
+        vertices[i] = region.u0 + vertices[i] * (region.u1 - region.u0);
+        vertices[i + 1] = region.v0 + vertices[i + 1] * (region.v1 - region.v0);
+    }
+}
+
+// Ścieżki tekstur jednego aiMaterial. Wyjmowane zaraz po imporcie, żeby scenę Assimpa
+// można było zwolnić przed dekodowaniem i wysyłaniem tekstur.
+struct MaterialSource {
+    bool valid = false;  // scena miała materiały
+    std::string diffuse, specular, normal, height, emissive;  // pełne ścieżki, puste = brak slotu
+    bool opacityMap = false;
+
+    // Tablica tekstur niesie tylko diffuse - materiały z innymi slotami idą zwykłą ścieżką
+    bool hasExtraMaps() const { return !specular.empty() || !normal.empty() || !height.empty() || !emissive.empty(); }
+};
+
+MaterialSource extractMaterialSource(aiMaterial* material, const std::string& directory) {
+    MaterialSource source;
+    source.valid = true;
+    auto slotPath = [&](aiTextureType type) {
+        if (material->GetTextureCount(type) == 0) return std::string();
+        aiString path;
+        material->GetTexture(type, 0, &path);
+        return resolveTexturePath(path.C_Str(), directory);
+    };
+    source.diffuse = slotPath(aiTextureType_DIFFUSE);
+    source.specular = slotPath(aiTextureType_SPECULAR);
+    source.normal = slotPath(aiTextureType_NORMALS);
+    source.height = slotPath(aiTextureType_HEIGHT);
+    source.emissive = slotPath(aiTextureType_EMISSIVE);
+    source.opacityMap = material->GetTextureCount(aiTextureType_OPACITY) > 0;
+    return source;
+}
+
+GLuint loadTextureSlot(const std::string& fullPath) {
+    return fullPath.empty() ? 0 : loadTextureFile(fullPath, nullptr);
+}
+
+// Diffuse z atlasu, jeśli tekstura w nim jest i UV submesha na to pozwalają
+GLuint loadDiffuse(const std::string& fullPath, const std::string& directory, const std::map<std::string, AtlasRegion>& atlas,
+                   float* vertices, size_t vertexCount, AlphaMode* alphaOut) {
+    if (fullPath.empty()) return 0;
+
+    std::string fileName = fullPath.substr(fullPath.find_last_of('/') + 1);
+
+    auto region = atlas.find(fileName);
+    if (region != atlas.end() && uvsInUnitRange(vertices, vertexCount)) {
+        // Bez strony (np. GPU bez kompresji, a RGBA nie jest publikowane) zostaje osobna tekstura
+        GLuint page = loadAtlasPage(directory + "/" + region->second.page, alphaOut);
+        if (page) {
+            remapUVs(vertices, vertexCount, region->second);
+            std::cout << " - " << fileName << " z " << region->second.page << "\n";
+            return page;
+        }
+    }
+    return loadTextureFile(fullPath, alphaOut);
+}
+
+Material loadMaterial(const MaterialSource& source, const std::string& directory,
+                      const std::map<std::string, AtlasRegion>& atlas, float* vertices, size_t vertexCount) {
+    Material mat;
+    if (!source.valid) {
+        std::cerr << "Brak materialow w scenie.\n";
+        return mat;
+    }
+
+    mat.diffuse = loadDiffuse(source.diffuse, directory, atlas, vertices, vertexCount, &mat.alphaMode);
+
+    mat.specular = loadTextureSlot(source.specular);
+    mat.emissive = loadTextureSlot(source.emissive);
+
+    // Importery zapisują mapy normalnych jako NORMALS albo (OBJ map_bump) HEIGHT
+    mat.normal = loadTextureSlot(source.normal);
+    if (!mat.normal) {
+        mat.normal = loadTextureSlot(source.height);
+    }
+
+    // Osobna mapa przezroczystości wymusza blending (alfa i tak pochodzi z diffuse)
+    if (source.opacityMap) {
+        mat.alphaMode = AlphaMode::Blend;
+    }
+
+    const char* alphaNames[] = {"opaque", "mask", "blend"};
+    std::cout << " - tryb alfy: " << alphaNames[(int)mat.alphaMode] << "\n";
+
+    return mat;
+}
+
+// --- Tablica tekstur (backend GLES3) ---
+// Wszystkie warianty tablicy muszą mieć wspólny rozmiar i format. bake --array zapisuje warstwy
+// jako Nazwa.array.*.ktx: kwadrat potęgi dwójki o boku najdłuższej tekstury i format z alfą.
+// Warstwy, które się nie zgadzają, są odrzucane - wtedy tablica powstaje z PNG według tej
+// samej reguły rozmiaru. Alfa jest klasyfikowana w addLayer: półprzezroczyste tekstury nie
+// trafiają do tablicy, maskowane przełączają ją na wariant shadera z discard. Tablica nie
+// jest strumieniowana.
+const int arrayMaxLayer = 2048;  // jak w bake.cpp
+
+class TextureArrayBuilder {
+public:
+    std::vector<std::string> paths;
+    std::vector<AlphaMode> alphaModes;
+
+    int addLayer(const std::string& path);  // -1: tekstura nie nadaje się do tablicy
+    bool hasMaskLayers() const;
+    GLuint build();
+
+private:
+    GLuint buildFromKtx(int codec);
+    GLuint buildFromPng();
+};
+
+std::string arrayLayerPath(const std::string& path, int codec) {
+    size_t dot = path.find_last_of('.');
+    std::string base = (dot == std::string::npos) ? path : path.substr(0, dot);
+    return base + ".array." + codecSuffix[codec] + ".ktx";
+}
+
+// Bok warstwy tablicy z PNG: najdłuższy bok zaokrąglony w górę do potęgi dwójki (jak bake --array)
+int arrayLayerSize(int longest) {
+    int size = 1;
+    while (size < longest && size < arrayMaxLayer) size <<= 1;
+    return size;
+}
+
+// Alfa tekstury przed przydziałem warstwy: z pary klucz-wartość pliku KTX, który wczyta
+// build() (ta sama kolejność kodeków), potem zwykłego wariantu tekstury (bake --array pomija
+// półprzezroczyste, a z manifestem ich PNG nie jest pobierany), a bez KTX - z pikseli PNG
+bool layerAlphaMode(const std::string& path, AlphaMode& alpha) {
+    for (int c = 0; c < CODEC_COUNT; ++c) {
+        if (!codecSupported[c] || c == CODEC_ETC1) continue;
+        std::string ktxPath = arrayLayerPath(path, c);
+        KtxInfo info;
+        alpha = AlphaMode::Opaque;
+        if (fileExists(ktxPath) && readKtxInfo(ktxPath, info, &alpha)) return true;
+    }
+    size_t dot = path.find_last_of('.');
+    std::string base = (dot == std::string::npos) ? path : path.substr(0, dot);
+    for (int c = 0; c < CODEC_COUNT; ++c) {
+        std::string ktxPath = base + "." + codecSuffix[c] + ".ktx";
+        KtxInfo info;
+        alpha = AlphaMode::Opaque;
+        if (codecSupported[c] && fileExists(ktxPath) && readKtxInfo(ktxPath, info, &alpha)) return true;
+    }
+    DecodedImage image;
+    if (!decodeImage(path, image)) return false;
+    alpha = classifyAlpha(image.pixels, image.width, image.height, image.channels);
+    freeDecodedImage(image);
+    return true;
+}
+
+int TextureArrayBuilder::addLayer(const std::string& path) {
+    if (path.empty()) return -1;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (paths[i] == path) return (int)i;
+    }
+    // Półprzezroczyste muszą być sortowane - zostają przy zwykłych materiałach
+    AlphaMode alpha;
+    if (!layerAlphaMode(path, alpha) || alpha == AlphaMode::Blend) return -1;
+    paths.push_back(path);
+    alphaModes.push_back(alpha);
+    return (int)paths.size() - 1;
+}
+
+bool TextureArrayBuilder::hasMaskLayers() const {
+    return std::find(alphaModes.begin(), alphaModes.end(), AlphaMode::Mask) != alphaModes.end();
+}
+
+GLuint TextureArrayBuilder::build() {
+    if (paths.empty()) return 0;
+
+    // ETC1 w WebGL istnieje tylko dla GL_TEXTURE_2D
+    for (int c = 0; c < CODEC_COUNT; ++c) {
+        if (!codecSupported[c] || c == CODEC_ETC1) continue;
+        GLuint tex = buildFromKtx(c);
+        if (tex) return tex;
+    }
+    return buildFromPng();
+}
+
+GLuint TextureArrayBuilder::buildFromKtx(int codec) {
+    std::vector<KtxInfo> infos(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        std::string ktxPath = arrayLayerPath(paths[i], codec);
+        if (!fileExists(ktxPath) || !readKtxInfo(ktxPath, infos[i], nullptr)) return 0;
+        const KtxInfo& info = infos[i];
+        const KtxInfo& first = infos[0];
+        if (!isPowerOfTwo(info.width) || info.width != info.height || info.width != first.width ||
+            info.internalFormat != first.internalFormat || info.glType != first.glType ||
+            info.levelSize.size() != first.levelSize.size()) {
+            std::cerr << "Tablica tekstur: " << ktxPath << " ma inny rozmiar albo format niz reszta warstw"
+                      << " (bake --array)\n";
+            return 0;
+        }
+    }
+
+    const KtxInfo& first = infos[0];
+    bool raw = first.glType != 0;
+    GLenum storageFormat = raw ? GL_RGBA8 : first.internalFormat;
+    int size = first.width;
+    int levels = (int)first.levelSize.size();
+
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, tex);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, storageFormat, size, size, (GLsizei)paths.size());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    size_t totalSize = 0;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        const KtxInfo& info = infos[i];
+        MappedFile f(info.path);
+        for (int level = 0; level < levels; ++level) {
+            int w = std::max(1, size >> level);
+            size_t levelSize = info.levelSize[level];
+            if (info.levelOffset[level] + levelSize > f.size()) {
+                std::cerr << "Uciety plik KTX: " << info.path << "\n";
+                glDeleteTextures(1, &tex);
+                return 0;
+            }
+            const unsigned char* data = f.data() + info.levelOffset[level];
+            if (raw) {
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, (GLint)i, w, w, 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+            } else {
+                glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, (GLint)i, w, w, 1, storageFormat,
+                                          (GLsizei)levelSize, data);
+            }
+            totalSize += levelSize;
+        }
+    }
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    resourceTracker.record(GpuResource::Texture, tex, totalSize);
+    std::cout << "Tablica tekstur " << codecSuffix[codec] << ": " << paths.size() << " warstw " << size << "x" << size
+              << ", " << levels << " poziomow, " << totalSize / 1024 << " KB\n";
+    return tex;
+}
+
+GLuint TextureArrayBuilder::buildFromPng() {
+    // Pierwsze przejście: tylko nagłówki, żeby znać rozmiar warstw przed dekodowaniem
+    int longest = 1;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        // Z manifestem PNG jest pobierany tylko wtedy, gdy brakuje warstw KTX (modelTextureAssets)
+        MappedFile file(paths[i]);
+        if (!file) {
+            std::cerr << "Tablica tekstur: brak " << paths[i] << " w systemie plikow (nie pobrano PNG)\n";
+            return 0;
+        }
+        int w, h, comp;
+        if (!stbi_info_from_memory(file.data(), (int)file.size(), &w, &h, &comp)) {
+            std::cerr << "Nie udalo sie zaladowac tekstury: " << paths[i] << " (" << stbi_failure_reason() << ")\n";
+            return 0;
+        }
+        longest = std::max({longest, w, h});
+    }
+
+    int layerSize = arrayLayerSize(longest);
+    int levels = 1;
+    while ((layerSize >> levels) > 0) ++levels;
+
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, tex);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, GL_RGBA8, layerSize, layerSize, (GLsizei)paths.size());
+    resourceTracker.record(GpuResource::Texture, tex, mipChainBytes(layerSize, layerSize, 4, true) * paths.size());
+
+    GLuint framebuffers[2];
+    glGenFramebuffers(2, framebuffers);
+    GLuint source;
+    glGenTextures(1, &source);
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        DecodedImage image;
+        if (!decodeImage(paths[i], image)) continue;
+
+        GLenum format = (image.channels == 4) ? GL_RGBA : GL_RGB;
+        glBindTexture(GL_TEXTURE_2D, source);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        setUnpackAlignment(image.width, image.channels);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels);
+        freeDecodedImage(image);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[0]);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, source, 0);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+        glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, tex, 0, (GLint)i);
+        glBlitFramebuffer(0, 0, image.width, image.height, 0, 0, layerSize, layerSize, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(2, framebuffers);
+    glDeleteTextures(1, &source);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, tex);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    std::cout << "Tablica tekstur RGBA8 z PNG: " << paths.size() << " warstw " << layerSize << "x" << layerSize << "\n";
+    return tex;
+}
+
+// --- Tekstury modelu do pobrania ---
+// Druga część plików startowych, gdy FBX jest już w systemie plików: tylko tekstury z materiałów
+// modelu, w postaci, którą wczyta aktywny backend (te same warunki co Model::load). GLES3 bierze
+// warstwy tablicy dla materiałów z samym diffuse, GLES2 - strony atlasu dla diffuse z atlas.txt.
+// Reszta to osobne pliki: pierwszy obsługiwany wariant KTX, a bez niego PNG.
+std::string compressedVariantAsset(const std::string& base) {
+    for (int c = 0; c < CODEC_COUNT; ++c) {
+        std::string ktxPath = base + "." + codecSuffix[c] + ".ktx";
+        if (codecSupported[c] && assetStore.contains(ktxPath)) return ktxPath;
+    }
+    return std::string();
+}
+
+std::string textureFileAsset(const std::string& path) {
+    size_t dot = path.find_last_of('.');
+    std::string ktxPath = compressedVariantAsset((dot == std::string::npos) ? path : path.substr(0, dot));
+    return ktxPath.empty() ? path : ktxPath;
+}
+
+std::string arrayLayerAsset(const std::string& path) {
+    for (int c = 0; c < CODEC_COUNT; ++c) {
+        if (!codecSupported[c] || c == CODEC_ETC1) continue;
+        if (assetStore.contains(arrayLayerPath(path, c))) return arrayLayerPath(path, c);
+    }
+    return std::string();
+}
+
+// Surowe UV z pliku - jak uvsInUnitRange po imporcie (Triangulate ich nie zmienia)
+bool materialUvsInUnitRange(const aiScene* scene, unsigned int materialIndex) {
+    for (unsigned int m = 0; m < scene->mNumMeshes; ++m) {
+        const aiMesh* mesh = scene->mMeshes[m];
+        if (mesh->mMaterialIndex != materialIndex || !mesh->HasTextureCoords(0)) continue;
+        for (unsigned int j = 0; j < mesh->mNumVertices; ++j) {
+            float u = mesh->mTextureCoords[0][j].x, v = mesh->mTextureCoords[0][j].y;
+            if (u < 0.0f || u > 1.0f || v < 0.0f || v > 1.0f) return false;
+        }
+    }
+    return true;
+}
+
+std::vector<std::string> modelTextureAssets(const aiScene* scene, const std::string& directory) {
+    std::vector<std::string> paths;
+    if (!scene || !assetStore.hasManifest()) return paths;
+
+    bool useArray = (renderBackend == RenderBackend::GLES3);
+    std::map<std::string, AtlasRegion> atlas;
+    if (!useArray) atlas = loadAtlasManifest(directory);
+
+    std::set<std::string> files;
+    std::vector<std::string> layersWithoutKtx;
+    bool anyArrayLayer = false;
+    for (unsigned int i = 0; i < scene->mNumMaterials; ++i) {
+        MaterialSource source = extractMaterialSource(scene->mMaterials[i], directory);
+        // HEIGHT jest czytany tylko jako zastępstwo brakującej mapy normalnych
+        const std::string& normalMap = source.normal.empty() ? source.height : source.normal;
+        for (const std::string& slot : {source.specular, source.emissive, normalMap}) {
+            if (!slot.empty()) files.insert(textureFileAsset(slot));
+        }
+        if (source.diffuse.empty()) continue;
+
+        if (useArray && !source.opacityMap && !source.hasExtraMaps()) {
+            std::string layer = arrayLayerAsset(source.diffuse);
+            if (!layer.empty()) {
+                files.insert(layer);
+                anyArrayLayer = true;
+                continue;
+            }
+            // Bez warstwy: tekstura półprzezroczysta (zwykły materiał) albo brak bake --array
+            layersWithoutKtx.push_back(source.diffuse);
+        } else {
+            std::string fileName = source.diffuse.substr(source.diffuse.find_last_of('/') + 1);
+            auto region = atlas.find(fileName);
+            if (region != atlas.end() && materialUvsInUnitRange(scene, i)) {
+                std::string page = compressedVariantAsset(directory + "/" + region->second.page);
+                if (!page.empty()) {
+                    files.insert(page);
+                    continue;
+                }
+            }
+        }
+        files.insert(textureFileAsset(source.diffuse));
+    }
+    // Bez żadnej warstwy KTX tablica powstaje z PNG (buildFromPng)
+    if (!anyArrayLayer) files.insert(layersWithoutKtx.begin(), layersWithoutKtx.end());
+
+    for (const std::string& file : files) {
+        if (assetStore.contains(file)) paths.push_back(file);
+    }
+    std::cout << "Tekstury modelu do pobrania: " << paths.size() << " plikow ("
+              << (useArray ? "tablica tekstur" : "atlas") << ")\n";
+    return paths;
+}
+
+// --- Model (implementacja metod) ---
+// --- Przeplot atrybutów wierzchołków ---
+// Kernel SIMD w interleave.h, wspólny z sceny2.cpp i finał.cpp; tu układ [p n uv] z pudełkiem submesha
+void interleaveVertices(const aiMesh* mesh, float* out, glm::vec3& boundsMin, glm::vec3& boundsMax) {
+    InterleaveBounds bounds;
+    interleaveAttributes(mesh, out, InterleaveOptions(), &bounds);
+    boundsMin = glm::min(boundsMin, glm::vec3(bounds.min[0], bounds.min[1], bounds.min[2]));
+    boundsMax = glm::max(boundsMax, glm::vec3(bounds.max[0], bounds.max[1], bounds.max[2]));
+}
+
+#ifdef INTERLEAVE_BENCH
+// Poprzednia pętla skalarna z rozgałęzieniami - punkt odniesienia dla benchmarku
+void interleaveReference(const aiMesh* mesh, float* out, glm::vec3& boundsMin, glm::vec3& boundsMax) {
+    for (unsigned int j = 0; j < mesh->mNumVertices; ++j) {
+        float* v = out + (size_t)j * 8;
+        v[0] = mesh->mVertices[j].x;
+        v[1] = mesh->mVertices[j].y;
+        v[2] = mesh->mVertices[j].z;
+
+        glm::vec3 p(v[0], v[1], v[2]);
+        boundsMin = glm::min(boundsMin, p);
+        boundsMax = glm::max(boundsMax, p);
+
+        if (mesh->HasNormals()) {
+            v[3] = mesh->mNormals[j].x;
+            v[4] = mesh->mNormals[j].y;
+            v[5] = mesh->mNormals[j].z;
+        } else {
+            v[3] = v[4] = v[5] = 0.0f;
+        }
+
+        if (mesh->HasTextureCoords(0)) {
+            v[6] = mesh->mTextureCoords[0][j].x;
+            v[7] = mesh->mTextureCoords[0][j].y;
+        } else {
+            v[6] = v[7] = 0.0f;
+        }
+    }
+}
+
+// Wszystkie meshe sceny, wiele powtórzeń; wynik musi być identyczny bit w bit
+void benchmarkInterleave(const aiScene* scene) {
+    const int iterations = 50;
+    size_t totalVertices = 0;
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i) totalVertices += scene->mMeshes[i]->mNumVertices;
+    std::vector<float> reference(totalVertices * 8), simd(totalVertices * 8);
+
+    auto run = [&](void (*kernel)(const aiMesh*, float*, glm::vec3&, glm::vec3&), std::vector<float>& out) {
+        auto start = std::chrono::steady_clock::now();
+        for (int it = 0; it < iterations; ++it) {
+            size_t offset = 0;
+            for (unsigned int i = 0; i < scene->mNumMeshes; ++i) {
+                glm::vec3 bmin(1e30f), bmax(-1e30f);
+                kernel(scene->mMeshes[i], out.data() + offset * 8, bmin, bmax);
+                offset += scene->mMeshes[i]->mNumVertices;
+            }
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / ((double)iterations * totalVertices);
+    };
+
+    double scalarNs = run(interleaveReference, reference);
+    double simdNs = run(interleaveVertices, simd);
+    bool same = memcmp(reference.data(), simd.data(), reference.size() * sizeof(float)) == 0;
+    std::cout << "Przeplot " << totalVertices << " wierzcholkow: skalarnie " << scalarNs << " ns/wierzch., SIMD "
+              << simdNs << " ns/wierzch. (x" << scalarNs / simdNs << ")" << (same ? "" : " - WYNIKI ROZNE!") << "\n";
+}
+#endif
+
+// --- System zadań ---
+// Pula wątków z dequami Chase-Leva w jobs.h, wspólna z testem jobs_test.cpp
+
+// --- Arena ładowania ---
+// Bufory pośrednie geometrii żyją tylko do wysłania na GPU. Rozmiary znamy z góry
+// (mNumVertices, liczba indeksów ścian), więc przydział to przesunięcie wskaźnika
+// w dużym bloku, a wszystko zwalnia jedno release() po uploadzie.
+class LoadArena {
+public:
+    explicit LoadArena(size_t blockSize = 4 * 1024 * 1024) : blockSize(blockSize) {}
+    ~LoadArena() { release(); }
+
+    template <typename T>
+    T* alloc(size_t count) {
+        size_t bytes = (count * sizeof(T) + 15) & ~(size_t)15;
+        if (blocks.empty() || blocks.back().used + bytes > blocks.back().size) {
+            Block block;
+            block.size = std::max(blockSize, bytes);
+            block.data = (unsigned char*)aligned_alloc(16, block.size);
+            countHeapAlloc(block.data);
+            blocks.push_back(block);
+        }
+        Block& block = blocks.back();
+        T* ptr = (T*)(block.data + block.used);
+        block.used += bytes;
+        totalUsed += bytes;
+        return ptr;
+    }
+
+    void release() {
+        for (Block& block : blocks) {
+            countHeapFree(block.data);
+            free(block.data);
+        }
+        blocks.clear();
+        totalUsed = 0;
+    }
+
+    size_t bytesUsed() const { return totalUsed; }
+    size_t blockCount() const { return blocks.size(); }
+
+private:
+    struct Block {
+        unsigned char* data = nullptr;
+        size_t size = 0;
+        size_t used = 0;
+    };
+    std::vector<Block> blocks;
+    size_t blockSize;
+    size_t totalUsed = 0;
+};
+
+// Dane submesha przed wysłaniem na GPU, bufory w LoadArena
+struct MeshBuild {
+    float* vertices = nullptr;        // 8 floatów na wierzchołek, 9 z warstwą tablicy tekstur
+    unsigned int* indices = nullptr;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    Material material;
+    glm::vec3 boundsMin = glm::vec3(1e30f);
+    glm::vec3 boundsMax = glm::vec3(-1e30f);
+    unsigned int sourceMesh = 0;
+    unsigned int sourceMaterial = 0;  // indeks w materiałach wyjętych ze sceny
+    int layer = -1;            // GLES3: warstwa w tablicy tekstur
+    bool hasTangents = false;  // materiał z mapą normalnych - 9. składowa to styczna
+    int node = 0;              // pierwszy węzeł grafu, który używa tego aiMesh
+    bool instanced = false;    // aiMesh użyty przez kilka węzłów - nie scalamy z innymi
+
+    size_t floatsPerVertex() const { return (layer >= 0 || hasTangents) ? 9 : 8; }
+};
+
+// Skleja grupę submeshy w jeden bufor o dokładnym rozmiarze; withLayer dopisuje 9. składową
+MeshBuild mergeBuilds(const std::vector<MeshBuild*>& group, bool withLayer, LoadArena& arena) {
+    if (group.size() == 1 && !withLayer) return *group[0];
+
+    MeshBuild merged;
+    merged.material = group[0]->material;
+    merged.layer = withLayer ? 0 : -1;
+    merged.hasTangents = group[0]->hasTangents;
+    merged.node = group[0]->node;
+    merged.sourceMesh = group[0]->sourceMesh;
+    for (const MeshBuild* build : group) {
+        merged.vertexCount += build->vertexCount;
+        merged.indexCount += build->indexCount;
+    }
+
+    size_t stride = merged.floatsPerVertex();
+    merged.vertices = arena.alloc<float>(merged.vertexCount * stride);
+    merged.indices = arena.alloc<unsigned int>(merged.indexCount);
+
+    size_t vertexBase = 0, indexBase = 0;
+    for (const MeshBuild* build : group) {
+        float* out = merged.vertices + vertexBase * stride;
+        if (withLayer) {
+            for (size_t v = 0; v < build->vertexCount; ++v) {
+                memcpy(out + v * 9, build->vertices + v * 8, sizeof(float) * 8);
+                out[v * 9 + 8] = (float)build->layer;
+            }
+        } else {
+            memcpy(out, build->vertices, build->vertexCount * sizeof(float) * stride);
+        }
+        for (size_t i = 0; i < build->indexCount; ++i) {
+            merged.indices[indexBase + i] = (unsigned int)vertexBase + build->indices[i];
+        }
+        merged.boundsMin = glm::min(merged.boundsMin, build->boundsMin);
+        merged.boundsMax = glm::max(merged.boundsMax, build->boundsMax);
+        vertexBase += build->vertexCount;
+        indexBase += build->indexCount;
+    }
+    return merged;
+}
+
+// --- Przetwarzanie meshy po imporcie ---
+// Z parallelMeshImport Assimp robi tylko triangulację, a spawanie wierzchołków, normalne
+// i kolejność wierzchołków liczy processMesh - każdy mesh jako osobne zadanie w jobSystem().
+bool parallelMeshImport = true;
+
+uint32_t hashVertex(const float* v) {
+    uint32_t words[8];
+    memcpy(words, v, sizeof(words));
+    uint32_t h = 2166136261u;
+    for (uint32_t w : words) {
+        h = (h ^ w) * 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+// Łączy wierzchołki o identycznych bitach wszystkich atrybutów (jak JoinIdenticalVertices).
+// Unikalne rekordy są kompaktowane w miejscu - indeks docelowy nigdy nie wyprzedza źródłowego.
+size_t weldVertices(float* vertices, size_t count, std::vector<unsigned int>& remap) {
+    size_t tableSize = 16;
+    while (tableSize < count * 2) tableSize <<= 1;
+    std::vector<unsigned int> table(tableSize, UINT_MAX);
+    remap.resize(count);
+
+    size_t unique = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const float* record = vertices + i * 8;
+        size_t slot = hashVertex(record) & (tableSize - 1);
+        while (table[slot] != UINT_MAX && memcmp(vertices + (size_t)table[slot] * 8, record, sizeof(float) * 8) != 0) {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (table[slot] == UINT_MAX) {
+            if (unique != i) memcpy(vertices + unique * 8, record, sizeof(float) * 8);
+            table[slot] = (unsigned int)unique++;
+        }
+        remap[i] = table[slot];
+    }
+    return unique;
+}
+
+// Gładkie normalne ważone polem trójkątów (gdy plik ich nie ma)
+void generateNormals(float* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount) {
+    for (size_t t = 0; t + 2 < indexCount; t += 3) {
+        float* a = vertices + (size_t)indices[t] * 8;
+        float* b = vertices + (size_t)indices[t + 1] * 8;
+        float* c = vertices + (size_t)indices[t + 2] * 8;
+        glm::vec3 n = glm::cross(glm::vec3(b[0] - a[0], b[1] - a[1], b[2] - a[2]),
+                                 glm::vec3(c[0] - a[0], c[1] - a[1], c[2] - a[2]));
+        for (float* v : {a, b, c}) {
+            v[3] += n.x;
+            v[4] += n.y;
+            v[5] += n.z;
+        }
+    }
+    for (size_t i = 0; i < vertexCount; ++i) {
+        float* v = vertices + i * 8;
+        float length = std::sqrt(v[3] * v[3] + v[4] * v[4] + v[5] * v[5]);
+        if (length > 0.0f) {
+            v[3] /= length;
+            v[4] /= length;
+            v[5] /= length;
+        }
+    }
+}
+
+// Wierzchołki w kolejności pierwszego użycia przez indeksy - odczyty z VBO idą sekwencyjnie.
+// Nieużywane wierzchołki wypadają. Zwraca nową liczbę wierzchołków.
+size_t optimizeVertexFetch(float* vertices, size_t vertexCount, unsigned int* indices, size_t indexCount) {
+    std::vector<unsigned int> newIndex(vertexCount, UINT_MAX);
+    std::vector<float> reordered;
+    reordered.reserve(vertexCount * 8);
+    unsigned int next = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        unsigned int& mapped = newIndex[indices[i]];
+        if (mapped == UINT_MAX) {
+            mapped = next++;
+            reordered.insert(reordered.end(), vertices + (size_t)indices[i] * 8, vertices + (size_t)indices[i] * 8 + 8);
+        }
+        indices[i] = mapped;
+    }
+    memcpy(vertices, reordered.data(), reordered.size() * sizeof(float));
+    return next;
+}
+
+bool materialUsesNormalMap(const aiScene* scene, const aiMesh* mesh) {
+    if (!scene->HasMaterials()) return false;
+    const aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+    return material->GetTextureCount(aiTextureType_NORMALS) > 0 || material->GetTextureCount(aiTextureType_HEIGHT) > 0;
+}
+
+// Styczna jako 4 bajty ze znakiem zajmujące miejsce jednego floata
+float packTangent(const glm::vec3& t, float sign) {
+    int8_t q[4] = {
+        (int8_t)std::lround(glm::clamp(t.x, -1.0f, 1.0f) * 127.0f),
+        (int8_t)std::lround(glm::clamp(t.y, -1.0f, 1.0f) * 127.0f),
+        (int8_t)std::lround(glm::clamp(t.z, -1.0f, 1.0f) * 127.0f),
+        (int8_t)(sign < 0.0f ? -127 : 127)};
+    float packed;
+    memcpy(&packed, q, sizeof(packed));
+    return packed;
+}
+
+// Rozsuwa rekordy z 8 do 9 floatów; od końca, bo bufor ma już miejsce na 9 * count
+void widenVertices(float* vertices, size_t count) {
+    for (size_t i = count; i-- > 0;) {
+        memmove(vertices + i * 9, vertices + i * 8, sizeof(float) * 8);
+        vertices[i * 9 + 8] = 0.0f;
+    }
+}
+
+// Styczne z pochodnych UV trójkątów, sumowane na wierzchołkach, ortogonalizowane względem normalnej
+void generateTangents(float* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount) {
+    std::vector<glm::vec3> tangents(vertexCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> bitangents(vertexCount, glm::vec3(0.0f));
+    for (size_t t = 0; t + 2 < indexCount; t += 3) {
+        const float* a = vertices + (size_t)indices[t] * 9;
+        const float* b = vertices + (size_t)indices[t + 1] * 9;
+        const float* c = vertices + (size_t)indices[t + 2] * 9;
+        glm::vec3 e1(b[0] - a[0], b[1] - a[1], b[2] - a[2]);
+        glm::vec3 e2(c[0] - a[0], c[1] - a[1], c[2] - a[2]);
+        float du1 = b[6] - a[6], dv1 = b[7] - a[7];
+        float du2 = c[6] - a[6], dv2 = c[7] - a[7];
+        float det = du1 * dv2 - du2 * dv1;
+        if (std::fabs(det) < 1e-12f) continue;
+        float r = 1.0f / det;
+        glm::vec3 tangent = (e1 * dv2 - e2 * dv1) * r;
+        glm::vec3 bitangent = (e2 * du1 - e1 * du2) * r;
+        for (int k = 0; k < 3; ++k) {
+            tangents[indices[t + k]] += tangent;
+            bitangents[indices[t + k]] += bitangent;
+        }
+    }
+
+    for (size_t i = 0; i < vertexCount; ++i) {
+        float* v = vertices + i * 9;
+        glm::vec3 n(v[3], v[4], v[5]);
+        glm::vec3 t = tangents[i] - n * glm::dot(n, tangents[i]);
+        float length = glm::length(t);
+        t = (length > 1e-8f) ? t / length : glm::vec3(1.0f, 0.0f, 0.0f);
+        float sign = glm::dot(glm::cross(n, t), bitangents[i]) < 0.0f ? -1.0f : 1.0f;
+        v[8] = packTangent(t, sign);
+    }
+}
+
+// Jedno zadanie: bufory build.vertices (mNumVertices * 8, z stycznymi * 9) i build.indices są już przydzielone
+void processMesh(const aiMesh* mesh, MeshBuild& build, bool postProcess) {
+    interleaveVertices(mesh, build.vertices, build.boundsMin, build.boundsMax);
+
+    std::vector<unsigned int> remap;
+    if (postProcess) {
+        build.vertexCount = weldVertices(build.vertices, mesh->mNumVertices, remap);
+    }
+
+    size_t index = 0;
+    for (unsigned int j = 0; j < mesh->mNumFaces; ++j) {
+        const aiFace& face = mesh->mFaces[j];
+        for (unsigned int k = 0; k < face.mNumIndices; ++k) {
+            build.indices[index++] = postProcess ? remap[face.mIndices[k]] : face.mIndices[k];
+        }
+    }
+    if (!postProcess) {
+        // Styczne policzył Assimp (aiProcess_CalcTangentSpace), wierzchołki są 1:1
+        if (build.hasTangents && mesh->HasTangentsAndBitangents()) {
+            widenVertices(build.vertices, build.vertexCount);
+            for (size_t i = 0; i < build.vertexCount; ++i) {
+                glm::vec3 n(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+                glm::vec3 t(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
+                glm::vec3 b(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
+                build.vertices[i * 9 + 8] = packTangent(t, glm::dot(glm::cross(n, t), b));
+            }
+        } else {
+            build.hasTangents = false;
+        }
+        return;
+    }
+
+    if (!mesh->HasNormals()) {
+        generateNormals(build.vertices, build.vertexCount, build.indices, build.indexCount);
+    }
+    build.vertexCount = optimizeVertexFetch(build.vertices, build.vertexCount, build.indices, build.indexCount);
+
+    if (build.hasTangents) {
+        if (mesh->HasTextureCoords(0)) {
+            widenVertices(build.vertices, build.vertexCount);
+            generateTangents(build.vertices, build.vertexCount, build.indices, build.indexCount);
+        } else {
+            build.hasTangents = false;
+        }
+    }
+}
+
+// --- BVH trójkątów submesha (wybór promieniem) ---
+// Węzeł ma 32 bajty: dwa węzły w linii cache 64 B. Dzieci węzła wewnętrznego leżą obok
+// siebie (leftFirst, leftFirst + 1), liść wskazuje ciągły zakres trójkątów. Trójkąty są
+// przepisane w kolejności liści, więc przejście czyta pamięć sekwencyjnie.
+struct BvhNode {
+    float boundsMin[3];
+    unsigned int leftFirst;  // wewnętrzny: lewe dziecko, liść: pierwszy trójkąt
+    float boundsMax[3];
+    unsigned int count;      // 0 - węzeł wewnętrzny
+};
+static_assert(sizeof(BvhNode) == 32, "BvhNode ma mieć 32 bajty");
+
+struct BvhRay {
+    glm::vec3 origin, dir, invDir;
+#if defined(__wasm_simd128__)
+    v128_t origin4, invDir4;
+#elif defined(__SSE2__) || defined(_M_X64)
+    __m128 origin4, invDir4;
+#endif
+};
+
+class TriangleBvh {
+public:
+    void build(const float* vertices, size_t floatsPerVertex, const unsigned int* indices, size_t indexCount);
+    bool intersect(const glm::vec3& origin, const glm::vec3& dir, float& t, unsigned int& triangle, float& u, float& v) const;
+#ifdef PICK_BENCH
+    // Każdy trójkąt po kolei, bez drzewa - wzorzec dla benchmarkPick
+    bool intersectBruteForce(const glm::vec3& origin, const glm::vec3& dir, float& t, unsigned int& triangle) const;
+#endif
+    size_t nodeCount() const { return nodes.size(); }
+    int depth() const { return maxDepth; }
+
+private:
+    void subdivide(unsigned int nodeIndex, std::vector<glm::vec3>& centroids, int depth);
+    void refit(BvhNode& node) const;
+    bool findSplit(const BvhNode& node, const std::vector<glm::vec3>& centroids, int& axis, float& position, float& cost) const;
+
+    std::vector<BvhNode> nodes;
+    std::vector<glm::vec3> corners;        // 3 wierzchołki na trójkąt, w kolejności liści
+    std::vector<unsigned int> triangleId;  // numer trójkąta w oryginalnym buforze indeksów
+    int maxDepth = 0;                      // najgłębszy liść - wyznacza rozmiar stosu w intersect
+};
+
+// Wejście promienia w pudełko węzła; trzy osie naraz, czwarty tor (leftFirst/count) ignorowany
+inline bool rayHitsNode(const BvhNode& node, const BvhRay& ray, float maxT, float& tEnter) {
+#if defined(__wasm_simd128__)
+    v128_t t1 = wasm_f32x4_mul(wasm_f32x4_sub(wasm_v128_load(node.boundsMin), ray.origin4), ray.invDir4);
+    v128_t t2 = wasm_f32x4_mul(wasm_f32x4_sub(wasm_v128_load(node.boundsMax), ray.origin4), ray.invDir4);
+    v128_t tNear = wasm_f32x4_pmin(t1, t2);
+    v128_t tFar = wasm_f32x4_pmax(t1, t2);
+    float t0 = std::max(std::max(wasm_f32x4_extract_lane(tNear, 0), wasm_f32x4_extract_lane(tNear, 1)),
+                        wasm_f32x4_extract_lane(tNear, 2));
+    float t3 = std::min(std::min(wasm_f32x4_extract_lane(tFar, 0), wasm_f32x4_extract_lane(tFar, 1)),
+                        wasm_f32x4_extract_lane(tFar, 2));
+#elif defined(__SSE2__) || defined(_M_X64)
+    __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.boundsMin), ray.origin4), ray.invDir4);
+    __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.boundsMax), ray.origin4), ray.invDir4);
+    __m128 tNear = _mm_min_ps(t1, t2);
+    __m128 tFar = _mm_max_ps(t1, t2);
+    // Tor 0 = max/min z torów 0, 1, 2
+    __m128 nearYX = _mm_max_ps(tNear, _mm_shuffle_ps(tNear, tNear, _MM_SHUFFLE(3, 3, 3, 1)));
+    __m128 farYX = _mm_min_ps(tFar, _mm_shuffle_ps(tFar, tFar, _MM_SHUFFLE(3, 3, 3, 1)));
+    float t0 = _mm_cvtss_f32(_mm_max_ss(nearYX, _mm_shuffle_ps(tNear, tNear, _MM_SHUFFLE(3, 3, 3, 2))));
+    float t3 = _mm_cvtss_f32(_mm_min_ss(farYX, _mm_shuffle_ps(tFar, tFar, _MM_SHUFFLE(3, 3, 3, 2))));
+#else
+    float t0 = 0.0f, t3 = maxT;
+    for (int axis = 0; axis < 3; ++axis) {
+        float a = (node.boundsMin[axis] - ray.origin[axis]) * ray.invDir[axis];
+        float b = (node.boundsMax[axis] - ray.origin[axis]) * ray.invDir[axis];
+        t0 = std::max(t0, std::min(a, b));
+        t3 = std::min(t3, std::max(a, b));
+    }
+#endif
+    t0 = std::max(t0, 0.0f);
+    t3 = std::min(t3, maxT);
+    tEnter = t0;
+    return t0 <= t3;
+}
+
+void TriangleBvh::refit(BvhNode& node) const {
+    glm::vec3 lo(1e30f), hi(-1e30f);
+    for (size_t i = node.leftFirst * 3; i < (size_t)(node.leftFirst + node.count) * 3; ++i) {
+        lo = glm::min(lo, corners[i]);
+        hi = glm::max(hi, corners[i]);
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+        node.boundsMin[axis] = lo[axis];
+        node.boundsMax[axis] = hi[axis];
+    }
+}
+
+// Binowany SAH: 12 koszyków wzdłuż każdej osi po środkach trójkątów
+bool TriangleBvh::findSplit(const BvhNode& node, const std::vector<glm::vec3>& centroids, int& bestAxis,
+                            float& bestPosition, float& bestCost) const {
+    const int binCount = 12;
+    bestCost = 1e30f;
+    for (int axis = 0; axis < 3; ++axis) {
+        float lo = 1e30f, hi = -1e30f;
+        for (unsigned int i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+            lo = std::min(lo, centroids[i][axis]);
+            hi = std::max(hi, centroids[i][axis]);
+        }
+        if (hi - lo < 1e-6f) continue;
+
+        Aabb bins[binCount];
+        unsigned int binTriangles[binCount] = {};
+        float scale = binCount / (hi - lo);
+        for (unsigned int i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+            int bin = std::min(binCount - 1, (int)((centroids[i][axis] - lo) * scale));
+            ++binTriangles[bin];
+            for (int k = 0; k < 3; ++k) {
+                bins[bin].min = glm::min(bins[bin].min, corners[i * 3 + k]);
+                bins[bin].max = glm::max(bins[bin].max, corners[i * 3 + k]);
+            }
+        }
+
+        // Pola i liczności po lewej/prawej stronie każdej z binCount - 1 płaszczyzn
+        float leftArea[binCount - 1], rightArea[binCount - 1];
+        unsigned int leftCount[binCount - 1], rightCount[binCount - 1];
+        Aabb leftBox, rightBox;
+        unsigned int leftSum = 0, rightSum = 0;
+        for (int i = 0; i < binCount - 1; ++i) {
+            leftSum += binTriangles[i];
+            leftCount[i] = leftSum;
+            leftBox = mergeAabb(leftBox, bins[i]);
+            leftArea[i] = leftSum ? leftBox.surfaceArea() : 0.0f;
+
+            rightSum += binTriangles[binCount - 1 - i];
+            rightCount[binCount - 2 - i] = rightSum;
+            rightBox = mergeAabb(rightBox, bins[binCount - 1 - i]);
+            rightArea[binCount - 2 - i] = rightSum ? rightBox.surfaceArea() : 0.0f;
+        }
+        for (int i = 0; i < binCount - 1; ++i) {
+            float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestPosition = lo + (i + 1) / scale;
+            }
+        }
+    }
+    return bestCost < 1e30f;
+}
+
+void TriangleBvh::subdivide(unsigned int nodeIndex, std::vector<glm::vec3>& centroids, int depth) {
+    maxDepth = std::max(maxDepth, depth);
+    BvhNode& node = nodes[nodeIndex];
+    if (node.count <= 2) return;
+
+    int axis = 0;
+    float position = 0.0f, splitCost = 0.0f;
+    if (!findSplit(node, centroids, axis, position, splitCost)) return;
+    glm::vec3 extent(node.boundsMax[0] - node.boundsMin[0], node.boundsMax[1] - node.boundsMin[1],
+                     node.boundsMax[2] - node.boundsMin[2]);
+    float parentArea = 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+    if (splitCost >= node.count * parentArea) return;  // podział nie opłaca się - zostaje liść
+
+    // Podział w miejscu: trójkąty (i ich środki) po lewej stronie płaszczyzny na początek zakresu
+    unsigned int i = node.leftFirst;
+    unsigned int j = node.leftFirst + node.count - 1;
+    while (i <= j && j != UINT_MAX) {
+        if (centroids[i][axis] < position) {
+            ++i;
+        } else {
+            std::swap(centroids[i], centroids[j]);
+            std::swap(triangleId[i], triangleId[j]);
+            for (int k = 0; k < 3; ++k) std::swap(corners[i * 3 + k], corners[j * 3 + k]);
+            --j;
+        }
+    }
+    unsigned int leftCount = i - node.leftFirst;
+    if (leftCount == 0 || leftCount == node.count) return;
+
+    unsigned int left = (unsigned int)nodes.size();
+    nodes.resize(nodes.size() + 2);
+    BvhNode& parentNode = nodes[nodeIndex];  // resize mógł przenieść tablicę
+    nodes[left].leftFirst = parentNode.leftFirst;
+    nodes[left].count = leftCount;
+    nodes[left + 1].leftFirst = i;
+    nodes[left + 1].count = parentNode.count - leftCount;
+    parentNode.leftFirst = left;
+    parentNode.count = 0;
+
+    refit(nodes[left]);
+    refit(nodes[left + 1]);
+    subdivide(left, centroids, depth + 1);
+    subdivide(left + 1, centroids, depth + 1);
+}
+
+void TriangleBvh::build(const float* vertices, size_t floatsPerVertex, const unsigned int* indices, size_t indexCount) {
+    size_t triangleCount = indexCount / 3;
+    corners.resize(triangleCount * 3);
+    triangleId.resize(triangleCount);
+    std::vector<glm::vec3> centroids(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            const float* v = vertices + (size_t)indices[t * 3 + k] * floatsPerVertex;
+            corners[t * 3 + k] = glm::vec3(v[0], v[1], v[2]);
+        }
+        centroids[t] = (corners[t * 3] + corners[t * 3 + 1] + corners[t * 3 + 2]) * (1.0f / 3.0f);
+        triangleId[t] = (unsigned int)t;
+    }
+
+    nodes.clear();
+    nodes.reserve(triangleCount * 2);
+    nodes.emplace_back();
+    nodes[0].leftFirst = 0;
+    nodes[0].count = (unsigned int)triangleCount;
+    refit(nodes[0]);
+    maxDepth = 0;
+    subdivide(0, centroids, 0);
+    nodes.shrink_to_fit();
+}
+
+// Möller-Trumbore; przy trafieniu bliższym niż t nadpisuje t i współrzędne barycentryczne
+inline bool rayHitsTriangle(const glm::vec3* corner, const glm::vec3& origin, const glm::vec3& dir, float& t, float& u,
+                            float& v) {
+    glm::vec3 e1 = corner[1] - corner[0];
+    glm::vec3 e2 = corner[2] - corner[0];
+    glm::vec3 p = glm::cross(dir, e2);
+    float det = glm::dot(e1, p);
+    if (std::fabs(det) < 1e-12f) return false;
+    float invDet = 1.0f / det;
+    glm::vec3 s = origin - corner[0];
+    float bu = glm::dot(s, p) * invDet;
+    if (bu < 0.0f || bu > 1.0f) return false;
+    glm::vec3 q = glm::cross(s, e1);
+    float bv = glm::dot(dir, q) * invDet;
+    if (bv < 0.0f || bu + bv > 1.0f) return false;
+    float tHit = glm::dot(e2, q) * invDet;
+    if (tHit <= 0.0f || tHit >= t) return false;
+    t = tHit;
+    u = bu;
+    v = bv;
+    return true;
+}
+
+// Najbliższe trafienie przed t (wejście: dotychczasowe maksimum). Möller-Trumbore na trójkątach,
+// dzieci odwiedzane od bliższego, więc dalsze poddrzewo zwykle odpada na teście pudełka.
+bool TriangleBvh::intersect(const glm::vec3& origin, const glm::vec3& dir, float& t, unsigned int& triangle, float& u,
+                            float& v) const {
+    if (nodes.empty()) return false;
+    BvhRay ray;
+    ray.origin = origin;
+    ray.dir = dir;
+    ray.invDir = glm::vec3(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+#if defined(__wasm_simd128__)
+    ray.origin4 = wasm_f32x4_make(origin.x, origin.y, origin.z, 0.0f);
+    ray.invDir4 = wasm_f32x4_make(ray.invDir.x, ray.invDir.y, ray.invDir.z, 0.0f);
+#elif defined(__SSE2__) || defined(_M_X64)
+    ray.origin4 = _mm_setr_ps(origin.x, origin.y, origin.z, 0.0f);
+    ray.invDir4 = _mm_setr_ps(ray.invDir.x, ray.invDir.y, ray.invDir.z, 0.0f);
+#endif
+
+    // Na każdym poziomie czeka najwyżej jedno odłożone dziecko, więc wystarczy maxDepth + 1
+    // pozycji. Zwykle mieści się w tablicy na stosie; zdegenerowane drzewo dostaje bufor na stercie.
+    bool hit = false;
+    unsigned int localStack[64];
+    std::vector<unsigned int> heapStack;
+    unsigned int* stack = localStack;
+    if (maxDepth + 1 > 64) {
+        heapStack.resize(maxDepth + 1);
+        stack = heapStack.data();
+    }
+    int top = 0;
+    float tEnter;
+    if (!rayHitsNode(nodes[0], ray, t, tEnter)) return false;
+    stack[top++] = 0;
+    while (top > 0) {
+        const BvhNode& node = nodes[stack[--top]];
+        if (node.count > 0) {
+            for (unsigned int i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+                if (!rayHitsTriangle(&corners[i * 3], origin, dir, t, u, v)) continue;
+                triangle = triangleId[i];
+                hit = true;
+            }
+            continue;
+        }
+
+        float tLeft, tRight;
+        bool hitLeft = rayHitsNode(nodes[node.leftFirst], ray, t, tLeft);
+        bool hitRight = rayHitsNode(nodes[node.leftFirst + 1], ray, t, tRight);
+        if (hitLeft && hitRight) {
+            // Bliższe dziecko na wierzch stosu
+            if (tLeft <= tRight) {
+                stack[top++] = node.leftFirst + 1;
+                stack[top++] = node.leftFirst;
+            } else {
+                stack[top++] = node.leftFirst;
+                stack[top++] = node.leftFirst + 1;
+            }
+        } else if (hitLeft) {
+            stack[top++] = node.leftFirst;
+        } else if (hitRight) {
+            stack[top++] = node.leftFirst + 1;
+        }
+    }
+    return hit;
+}
+
+#ifdef PICK_BENCH
+bool TriangleBvh::intersectBruteForce(const glm::vec3& origin, const glm::vec3& dir, float& t, unsigned int& triangle) const {
+    bool hit = false;
+    float u, v;
+    for (size_t i = 0; i < triangleId.size(); ++i) {
+        if (!rayHitsTriangle(&corners[i * 3], origin, dir, t, u, v)) continue;
+        triangle = triangleId[i];
+        hit = true;
+    }
+    return hit;
+}
+#endif
+
+// --- Graf sceny ---
+int SceneGraph::addNode(int parentIndex, const std::string& name, const Transform& transform) {
+    parent.push_back(parentIndex);
+    names.push_back(name);
+    local.push_back(transform);
+    world.push_back(glm::mat4(1.0f));
+    dirty.push_back(1);
+    anyDirty = true;
+    return (int)parent.size() - 1;
+}
+
+void SceneGraph::setLocal(int node, const Transform& transform) {
+    Transform& current = local[node];
+    if (current.translation == transform.translation && current.rotation == transform.rotation &&
+        current.scale == transform.scale) {
+        return;
+    }
+    current = transform;
+    dirty[node] = 1;
+    anyDirty = true;
+}
+
+bool SceneGraph::update() {
+    if (!anyDirty) return false;
+    changed.assign(dirty.begin(), dirty.end());
+    for (size_t i = 0; i < parent.size(); ++i) {
+        // Rodzic jest wcześniej w tablicy, więc jego flaga jest już ustalona
+        int p = parent[i];
+        if (p >= 0 && dirty[p]) dirty[i] = 1;
+        if (!dirty[i]) continue;
+
+        const Transform& t = local[i];
+        glm::mat4 m = glm::translate(glm::mat4(1.0f), t.translation) * glm::mat4_cast(t.rotation) *
+                      glm::scale(glm::mat4(1.0f), t.scale);
+        world[i] = (p >= 0) ? world[p] * m : m;
+        changed[i] = 1;
+    }
+    std::fill(dirty.begin(), dirty.end(), 0);
+    anyDirty = false;
+    return true;
+}
+
+void SceneGraph::clear() {
+    parent.clear();
+    names.clear();
+    local.clear();
+    world.clear();
+    changed.clear();
+    dirty.clear();
+    anyDirty = false;
+}
+
+// --- Drzewo AABB (implementacja) ---
+int AabbTree::allocateNode() {
+    if (freeList < 0) {
+        nodes.emplace_back();
+        return (int)nodes.size() - 1;
+    }
+    int index = freeList;
+    freeList = nodes[index].parent;
+    nodes[index] = Node();
+    return index;
+}
+
+void AabbTree::freeNode(int index) {
+    nodes[index].parent = freeList;
+    nodes[index].height = -1;
+    freeList = index;
+}
+
+int AabbTree::insert(const Aabb& box, int userData) {
+    int leaf = allocateNode();
+    nodes[leaf].box.min = box.min - glm::vec3(margin);
+    nodes[leaf].box.max = box.max + glm::vec3(margin);
+    nodes[leaf].userData = userData;
+    insertLeaf(leaf);
+    ++leaves;
+    return leaf;
+}
+
+void AabbTree::remove(int proxy) {
+    removeLeaf(proxy);
+    freeNode(proxy);
+    --leaves;
+}
+
+bool AabbTree::move(int proxy, const Aabb& box) {
+    if (nodes[proxy].box.contains(box)) return false;
+    removeLeaf(proxy);
+    nodes[proxy].box.min = box.min - glm::vec3(margin);
+    nodes[proxy].box.max = box.max + glm::vec3(margin);
+    insertLeaf(proxy);
+    return true;
+}
+
+void AabbTree::clear() {
+    nodes.clear();
+    root = -1;
+    freeList = -1;
+    leaves = 0;
+}
+
+void AabbTree::insertLeaf(int leaf) {
+    if (root < 0) {
+        root = leaf;
+        nodes[root].parent = -1;
+        return;
+    }
+
+    // Zejście w stronę tańszego dziecka: koszt to przyrost pola powierzchni
+    Aabb leafBox = nodes[leaf].box;
+    int index = root;
+    while (!nodes[index].isLeaf()) {
+        const Node& node = nodes[index];
+        float area = node.box.surfaceArea();
+        float combinedArea = mergeAabb(node.box, leafBox).surfaceArea();
+        float cost = 2.0f * combinedArea;                    // nowy rodzic dla node i liścia
+        float inheritance = 2.0f * (combinedArea - area);    // przyrost na ścieżce w dół
+
+        float childCost[2];
+        int children[2] = {node.left, node.right};
+        for (int c = 0; c < 2; ++c) {
+            const Node& child = nodes[children[c]];
+            float grown = mergeAabb(child.box, leafBox).surfaceArea();
+            childCost[c] = child.isLeaf() ? grown + inheritance : (grown - child.box.surfaceArea()) + inheritance;
+        }
+        if (cost < childCost[0] && cost < childCost[1]) break;
+        index = (childCost[0] < childCost[1]) ? children[0] : children[1];
+    }
+
+    int sibling = index;
+    int oldParent = nodes[sibling].parent;
+    int newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].box = mergeAabb(leafBox, nodes[sibling].box);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].left = sibling;
+    nodes[newParent].right = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+    if (oldParent < 0) {
+        root = newParent;
+    } else if (nodes[oldParent].left == sibling) {
+        nodes[oldParent].left = newParent;
+    } else {
+        nodes[oldParent].right = newParent;
+    }
+
+    refitUpwards(nodes[leaf].parent);
+}
+
+void AabbTree::removeLeaf(int leaf) {
+    if (leaf == root) {
+        root = -1;
+        return;
+    }
+    int parentIndex = nodes[leaf].parent;
+    int grandParent = nodes[parentIndex].parent;
+    int sibling = (nodes[parentIndex].left == leaf) ? nodes[parentIndex].right : nodes[parentIndex].left;
+
+    if (grandParent < 0) {
+        root = sibling;
+        nodes[sibling].parent = -1;
+        freeNode(parentIndex);
+        return;
+    }
+    if (nodes[grandParent].left == parentIndex) {
+        nodes[grandParent].left = sibling;
+    } else {
+        nodes[grandParent].right = sibling;
+    }
+    nodes[sibling].parent = grandParent;
+    freeNode(parentIndex);
+    refitUpwards(grandParent);
+}
+
+void AabbTree::refitUpwards(int index) {
+    while (index >= 0) {
+        index = balance(index);
+        Node& node = nodes[index];
+        node.height = 1 + std::max(nodes[node.left].height, nodes[node.right].height);
+        node.box = mergeAabb(nodes[node.left].box, nodes[node.right].box);
+        index = node.parent;
+    }
+}
+
+// Rotacja, gdy poddrzewa różnią się wysokością o więcej niż 1; zwraca nowy korzeń poddrzewa
+int AabbTree::balance(int a) {
+    Node& A = nodes[a];
+    if (A.isLeaf() || A.height < 2) return a;
+
+    int b = A.left, c = A.right;
+    int diff = nodes[c].height - nodes[b].height;
+    if (diff > -2 && diff < 2) return a;
+
+    // Wyższe dziecko (up) wchodzi na miejsce a, a trafia pod nie
+    int up = (diff > 0) ? c : b;
+    Node& U = nodes[up];
+    int f = U.left, g = U.right;
+
+    U.left = a;
+    U.parent = A.parent;
+    A.parent = up;
+    if (U.parent < 0) {
+        root = up;
+    } else if (nodes[U.parent].left == a) {
+        nodes[U.parent].left = up;
+    } else {
+        nodes[U.parent].right = up;
+    }
+
+    // Wyższy wnuk zostaje pod up, niższy wraca do a
+    int keep = (nodes[f].height > nodes[g].height) ? f : g;
+    int give = (keep == f) ? g : f;
+    U.right = keep;
+    if (diff > 0) {
+        A.right = give;
+    } else {
+        A.left = give;
+    }
+    nodes[give].parent = a;
+
+    A.box = mergeAabb(nodes[A.left].box, nodes[A.right].box);
+    A.height = 1 + std::max(nodes[A.left].height, nodes[A.right].height);
+    U.box = mergeAabb(A.box, nodes[keep].box);
+    U.height = 1 + std::max(A.height, nodes[keep].height);
+    return up;
+}
+
+// AABB lokalnych granic po przekształceniu macierzą świata (środek + |M| * połowa rozmiaru)
+Aabb worldBounds(const Mesh& mesh, const glm::mat4& world) {
+    glm::vec3 center = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+    glm::vec3 extent = (mesh.boundsMax - mesh.boundsMin) * 0.5f;
+    glm::vec3 worldCenter = glm::vec3(world * glm::vec4(center, 1.0f));
+    glm::vec3 worldExtent(0.0f);
+    for (int axis = 0; axis < 3; ++axis) {
+        worldExtent[axis] = std::fabs(world[0][axis]) * extent.x + std::fabs(world[1][axis]) * extent.y +
+                            std::fabs(world[2][axis]) * extent.z;
+    }
+    Aabb box;
+    box.min = worldCenter - worldExtent;
+    box.max = worldCenter + worldExtent;
+    return box;
+}
+
+SceneGraph::Transform transformFromAssimp(const aiMatrix4x4& matrix) {
+    aiVector3D scaling, position;
+    aiQuaternion rotation;
+    matrix.Decompose(scaling, rotation, position);
+
+    SceneGraph::Transform transform;
+    transform.translation = glm::vec3(position.x, position.y, position.z);
+    transform.rotation = glm::quat(rotation.w, rotation.x, rotation.y, rotation.z);
+    transform.scale = glm::vec3(scaling.x, scaling.y, scaling.z);
+    return transform;
+}
+
+// Ustawienie modelu (skala 0.1) i kamera są dobrane do postaci o boku pudełka ~9 jednostek.
+// Węzeł "fit" skaluje jednolicie i centruje pudełko całej hierarchii z pliku (bez obrotu),
+// więc kadr nie zależy od jednostek i położenia, w jakich model zapisano.
+const float modelFitSize = 9.0f;
+
+SceneGraph::Transform fitToFrame(const Aabb& bounds) {
+    SceneGraph::Transform fit;
+    fit.translation = glm::vec3(0.0f, -0.5f, 0.0f);
+    if (bounds.min.x > bounds.max.x) return fit;  // scena bez meshy
+    glm::vec3 extent = bounds.max - bounds.min;
+    float longest = std::max(extent.x, std::max(extent.y, extent.z));
+    float scale = longest > 0.0f ? modelFitSize / longest : 1.0f;
+    fit.scale = glm::vec3(scale);
+    fit.translation -= (bounds.min + bounds.max) * 0.5f * scale;
+    return fit;
+}
+
+// Przejście w głąb (pre-order) daje kolejność rodzic-przed-dzieckiem
+void collectNodes(const aiNode* node, int parentIndex, SceneGraph& graph, std::vector<std::vector<int>>& meshNodes) {
+    int index = graph.addNode(parentIndex, node->mName.C_Str(), transformFromAssimp(node->mTransformation));
+
+    for (unsigned int i = 0; i < node->mNumMeshes; ++i) {
+        meshNodes[node->mMeshes[i]].push_back(index);
+    }
+    for (unsigned int i = 0; i < node->mNumChildren; ++i) {
+        collectNodes(node->mChildren[i], index, graph, meshNodes);
+    }
+}
+
+// Ładowanie w fazach, żeby szczyt sterty nie sumował sceny Assimpa z teksturami:
+//  1. import i obróbka geometrii do areny, ścieżki tekstur do MaterialSource, graf sceny,
+//  2. zwolnienie aiScene (FreeScene) - dalej nic nie sięga do Assimpa,
+//  3. tekstury (tablica albo materiały, remap UV atlasu w arenie),
+//  4. scalanie, BVH, upload na GPU i zwolnienie areny.
+void Model::load(Assimp::Importer& importer, const std::string& path, const std::string& textureDir) {
+    // Bez parallelMeshImport cała obróbka idzie w Assimpie, na jednym wątku
+    unsigned int importFlags = aiProcess_Triangulate;
+    if (!parallelMeshImport) {
+        importFlags |= aiProcess_JoinIdenticalVertices | aiProcess_GenNormals;
+    }
+    auto importStart = std::chrono::steady_clock::now();
+    HeapSnapshot heapStart = beginHeapMeasure();
+    // Scena bywa już wczytana przy wyborze tekstur do pobrania - wtedy tylko obróbka
+    const aiScene* scene = importer.GetScene() ? importer.GetScene() : importer.ReadFile(path, 0);
+    if (scene) scene = importer.ApplyPostProcessing(importFlags);
+
+    // Styczne tylko, gdy któryś materiał ma mapę normalnych. Assimp liczy je wtedy dla
+    // całej sceny, równoległa obróbka - tylko dla meshy z takim materiałem.
+    bool anyNormalMaps = false;
+    for (unsigned int i = 0; scene && i < scene->mNumMeshes; ++i) {
+        anyNormalMaps = anyNormalMaps || materialUsesNormalMap(scene, scene->mMeshes[i]);
+    }
+    if (scene && anyNormalMaps && !parallelMeshImport) {
+        scene = importer.ApplyPostProcessing(aiProcess_CalcTangentSpace);
+    }
+    auto importEnd = std::chrono::steady_clock::now();
+
+    if (!scene || !scene->HasMeshes()) {
+        std::cerr << "Nie udalo sie zaladowac modelu: " << importer.GetErrorString() << "\n";
+        return;
+    }
+
+    // Faza 1: wszystko, co potrzebne ze sceny, trafia do zwartych struktur
+    std::vector<MaterialSource> materialSources(std::max(1u, scene->mNumMaterials));
+    for (unsigned int i = 0; i < scene->mNumMaterials; ++i) {
+        printAllMaterialTextures(scene->mMaterials[i]);
+        materialSources[i] = extractMaterialSource(scene->mMaterials[i], textureDir);
+    }
+
+    // Tablica tekstur zastępuje atlas - warstwy nie mają gutterów i działa GL_REPEAT
+    bool useArray = (renderBackend == RenderBackend::GLES3);
+    std::map<std::string, AtlasRegion> atlas;
+    if (!useArray) atlas = loadAtlasManifest(textureDir);
+    TextureArrayBuilder arrayBuilder;
+
+    // Węzeł 0 - ustawienie modelu (render() zmienia jego obrót), 1 - dopasowanie do kadru pod nim
+    // (fitToFrame), niżej hierarchia z pliku bez zmian. Oba na razie jednostkowe: po utworzeniu
+    // meshy macierze świata są w przestrzeni pliku i z nich liczone jest pudełko sceny.
+    graph.clear();
+    int root = graph.addNode(-1, "placement", SceneGraph::Transform());
+    int fitNode = graph.addNode(root, "fit", SceneGraph::Transform());
+    std::vector<std::vector<int>> meshNodes(scene->mNumMeshes);
+    if (scene->mRootNode) {
+        collectNodes(scene->mRootNode, fitNode, graph, meshNodes);
+    }
+    graph.update();
+
+    LoadArena arena;
+    std::vector<MeshBuild> builds(scene->mNumMeshes);
+
+    // Arena nie jest wielowątkowa - wszystkie bufory przydzielamy przed startem zadań.
+    // Spawanie tylko zmniejsza liczbę wierzchołków, więc mNumVertices jest górną granicą.
+    std::vector<size_t> order;
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i) {
+        const aiMesh* mesh = scene->mMeshes[i];
+        MeshBuild& build = builds[i];
+
+        build.vertexCount = mesh->mNumVertices;
+        build.hasTangents = materialUsesNormalMap(scene, mesh);
+        build.vertices = arena.alloc<float>(build.vertexCount * build.floatsPerVertex());
+        for (unsigned int j = 0; j < mesh->mNumFaces; ++j) {
+            build.indexCount += mesh->mFaces[j].mNumIndices;
+        }
+        build.indices = arena.alloc<unsigned int>(build.indexCount);
+
+        build.sourceMesh = i;
+        build.sourceMaterial = scene->HasMaterials() ? mesh->mMaterialIndex : 0;
+        if (meshNodes[i].empty()) meshNodes[i].push_back(fitNode);
+        build.node = meshNodes[i][0];
+        build.instanced = meshNodes[i].size() > 1;
+        const MaterialSource& source = materialSources[build.sourceMaterial];
+        if (useArray && !source.opacityMap && !source.hasExtraMaps()) {
+            build.layer = arrayBuilder.addLayer(source.diffuse);
+        }
+        order.push_back(i);
+    }
+
+    // Największe meshe najpierw, żeby ostatnie zadanie nie trzymało pozostałych wątków
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return scene->mMeshes[a]->mNumVertices > scene->mMeshes[b]->mNumVertices;
+    });
+    jobSystem().run(order, [&](size_t i) { processMesh(scene->mMeshes[i], builds[i], parallelMeshImport); });
+    auto processEnd = std::chrono::steady_clock::now();
+
+    std::chrono::duration<double, std::milli> importMs = importEnd - importStart;
+    std::chrono::duration<double, std::milli> processMs = processEnd - importEnd;
+    std::cout << "Import Assimp: " << importMs.count() << " ms, obrobka meshy: " << processMs.count() << " ms ("
+              << (parallelMeshImport ? "rownolegle" : "w Assimpie") << ", " << jobSystem().threadCount() << " watkow)\n";
+#ifdef INTERLEAVE_BENCH
+    benchmarkInterleave(scene);
+#endif
+
+    // Faza 2: geometria jest w arenie, ścieżki w materialSources - scena nie jest już potrzebna
+    importer.FreeScene();
+    scene = nullptr;
+
+    // Faza 3: tekstury. Nieprzezroczyste warstwy idą do jednego Mesh z tablicą tekstur, reszta zwykłą ścieżką
+    if (useArray) {
+        textureArray = arrayBuilder.build();
+        textureArrayMasked = textureArray && arrayBuilder.hasMaskLayers();
+        if (!textureArray && !arrayBuilder.paths.empty()) {
+            std::cerr << "Nie udalo sie zbudowac tablicy tekstur (" << arrayBuilder.paths.size()
+                      << " warstw) - submeshe rysowane osobno per material\n";
+        }
+    }
+    std::vector<MeshBuild*> layered;
+    std::vector<MeshBuild*> perMaterial;
+    for (MeshBuild& build : builds) {
+        if (textureArray && build.layer >= 0) {
+            layered.push_back(&build);
+            continue;
+        }
+        build.layer = -1;
+        build.material = loadMaterial(materialSources[build.sourceMaterial], textureDir, atlas, build.vertices, build.vertexCount);
+        perMaterial.push_back(&build);
+    }
+
+    // Faza 4: scalanie, BVH i upload
+    // Scalać można tylko submeshe z tego samego węzła - dzielą macierz świata
+    auto sameNode = [](const MeshBuild* a, const MeshBuild* b) {
+        return a->node == b->node && !a->instanced && !b->instanced;
+    };
+
+    // Submeshe z tym samym materiałem (po atlasie często ta sama strona) łączymy w jedno wywołanie.
+    // Półprzezroczystych nie ruszamy - muszą być sortowane osobno.
+    std::vector<std::vector<MeshBuild*>> groups;
+    for (MeshBuild* build : perMaterial) {
+        std::vector<MeshBuild*>* target = nullptr;
+        if (build->material.alphaMode != AlphaMode::Blend) {
+            for (auto& group : groups) {
+                if (group[0]->material.alphaMode != AlphaMode::Blend && group[0]->material.sameTextures(build->material) &&
+                    group[0]->hasTangents == build->hasTangents && sameNode(group[0], build)) {
+                    target = &group;
+                    break;
+                }
+            }
+        }
+        if (target) {
+            target->push_back(build);
+        } else {
+            groups.push_back({build});
+        }
+    }
+    std::cout << "Submeshe: " << perMaterial.size() << " -> " << groups.size() << " po scaleniu materialow\n";
+
+    std::vector<MeshBuild> merged;
+    merged.reserve(groups.size() + 1);
+    if (!layered.empty()) {
+        std::vector<std::vector<MeshBuild*>> layeredGroups;
+        for (MeshBuild* build : layered) {
+            auto it = std::find_if(layeredGroups.begin(), layeredGroups.end(),
+                                   [&](const std::vector<MeshBuild*>& group) { return sameNode(group[0], build); });
+            if (it != layeredGroups.end()) {
+                it->push_back(build);
+            } else {
+                layeredGroups.push_back({build});
+            }
+        }
+        std::cout << "Tablica tekstur: " << layered.size() << " submeshy w " << layeredGroups.size() << " wywolaniach\n";
+        merged.reserve(groups.size() + layeredGroups.size());
+        for (const auto& group : layeredGroups) {
+            merged.push_back(mergeBuilds(group, true, arena));
+        }
+    } else if (textureArray) {
+        resourceTracker.release(GpuResource::Texture, textureArray);
+        glDeleteTextures(1, &textureArray);
+        textureArray = 0;
+        textureArrayMasked = false;
+    }
+    for (const auto& group : groups) {
+        merged.push_back(mergeBuilds(group, false, arena));
+    }
+
+    // BVH trójkątów z danych CPU, zanim arena zostanie zwolniona; każdy submesh osobno, równolegle
+    auto bvhStart = std::chrono::steady_clock::now();
+    std::vector<std::shared_ptr<TriangleBvh>> bvhs(merged.size());
+    std::vector<size_t> bvhOrder(merged.size());
+    for (size_t i = 0; i < merged.size(); ++i) {
+        bvhOrder[i] = i;
+        bvhs[i] = std::make_shared<TriangleBvh>();
+    }
+    std::sort(bvhOrder.begin(), bvhOrder.end(), [&](size_t a, size_t b) { return merged[a].indexCount > merged[b].indexCount; });
+    jobSystem().run(bvhOrder, [&](size_t i) {
+        bvhs[i]->build(merged[i].vertices, merged[i].floatsPerVertex(), merged[i].indices, merged[i].indexCount);
+    });
+    size_t bvhNodes = 0;
+    for (const auto& bvh : bvhs) bvhNodes += bvh->nodeCount();
+    std::chrono::duration<double, std::milli> bvhMs = std::chrono::steady_clock::now() - bvhStart;
+    std::cout << "BVH trojkatow: " << bvhNodes << " wezlow (" << bvhNodes * sizeof(BvhNode) / 1024 << " KB), "
+              << bvhMs.count() << " ms\n";
+
+    meshes.reserve(merged.size());
+    for (size_t m = 0; m < merged.size(); ++m) {
+        const MeshBuild& build = merged[m];
+        Mesh newMesh;
+        newMesh.bvh = bvhs[m];
+        size_t stride = build.floatsPerVertex();
+        glGenBuffers(1, &newMesh.vbo);
         glBindBuffer(GL_ARRAY_BUFFER, newMesh.vbo);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, build.vertexCount * stride * sizeof(float), build.vertices, GL_STATIC_DRAW);
+        resourceTracker.record(GpuResource::VertexBuffer, newMesh.vbo, build.vertexCount * stride * sizeof(float));
+
+        glGenBuffers(1, &newMesh.ibo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, newMesh.ibo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, build.indexCount * sizeof(unsigned int), build.indices, GL_STATIC_DRAW);
+        resourceTracker.record(GpuResource::IndexBuffer, newMesh.ibo, build.indexCount * sizeof(unsigned int));
+
+        newMesh.indexCount = build.indexCount;
+        newMesh.material = build.material;
+        if (build.layer >= 0) newMesh.textureArray = textureArray;
+        newMesh.hasTangents = build.hasTangents;
+        newMesh.boundsMin = build.boundsMin;
+        newMesh.boundsMax = build.boundsMax;
+        newMesh.node = build.node;
+        meshes.push_back(newMesh);
+
+        // Pozostałe węzły z tym samym aiMesh rysują te same bufory z własną macierzą
+        if (build.instanced) {
+            const std::vector<int>& nodes = meshNodes[build.sourceMesh];
+            for (size_t n = 1; n < nodes.size(); ++n) {
+                Mesh instance = newMesh;
+                instance.node = nodes[n];
+                instance.ownsBuffers = false;
+                meshes.push_back(instance);
+            }
+        }
+    }
+    std::cout << "Graf sceny: " << graph.size() << " wezlow, " << meshes.size() << " wywolan rysowania\n";
+
+    Aabb fileBounds;
+    for (const Mesh& mesh : meshes) fileBounds = mergeAabb(fileBounds, worldBounds(mesh, graph.world[mesh.node]));
+    SceneGraph::Transform fit = fitToFrame(fileBounds);
+    SceneGraph::Transform placement;
+    placement.translation = glm::vec3(0.0f, -0.5f, 0.0f);
+    placement.scale = glm::vec3(0.1f);
+    graph.setLocal(fitNode, fit);
+    graph.setLocal(root, placement);
+    graph.update();
+    glm::vec3 extent = fileBounds.max - fileBounds.min;
+    std::cout << "Pudelko sceny w pliku: " << extent.x << " x " << extent.y << " x " << extent.z << ", skala dopasowania "
+              << fit.scale.x << "\n";
+
+    spatialIndex.clear();
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        meshes[i].proxy = spatialIndex.insert(worldBounds(meshes[i], graph.world[meshes[i].node]), (int)i);
+    }
+    std::cout << "Drzewo AABB: " << spatialIndex.leafCount() << " lisci, wysokosc " << spatialIndex.height() << "\n";
+
+    std::cout << "Geometria: " << arena.bytesUsed() / 1024 << " KB w " << arena.blockCount() << " blokach areny\n";
+    arena.release();
+    reportHeapMeasure("Ladowanie modelu", heapStart);
+}
+
+// Przelicza zmienione węzły i przenosi w drzewie AABB tylko te instancje, które
+// wyszły poza margines swojego liścia
+void Model::updateTransforms() {
+    if (!graph.update()) return;
+    for (Mesh& mesh : meshes) {
+        if (mesh.proxy < 0 || !graph.changed[mesh.node]) continue;
+        spatialIndex.move(mesh.proxy, worldBounds(mesh, graph.world[mesh.node]));
+    }
+}
+
+// Nieprzezroczyste zostają w kolejności z pliku, sortowane są tylko półprzezroczyste.
+// Każdy mesh dostaje gotową macierz świata ze swojego węzła (updateTransforms() przed wywołaniem).
+// Do kolejek trafiają tylko instancje, których liść drzewa AABB przecina ostrosłup widzenia.
+void Model::buildQueues(const glm::vec3& cameraPos, const glm::mat4& viewProjection, RenderQueues& queues) {
+    std::vector<std::pair<float, Mesh*>> blendedByDepth;
+
+    glm::vec4 planes[6];
+    extractFrustumPlanes(viewProjection, planes);
+    std::vector<unsigned char> visible(meshes.size(), 0);
+    spatialIndex.queryFrustum(planes, [&](int index) { visible[index] = 1; });
+
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        Mesh& mesh = meshes[i];
+        if (!visible[i]) continue;
+        mesh.world = &graph.world[mesh.node];
+        const glm::mat4& model = *mesh.world;
+        if (mesh.textureArray) {
+            queues.layered.push_back(&mesh);
+            continue;
+        }
+        switch (mesh.material.alphaMode) {
+        case AlphaMode::Opaque:
+            queues.opaque.push_back(&mesh);
+            break;
+        case AlphaMode::Mask:
+            queues.masked.push_back(&mesh);
+            break;
+        case AlphaMode::Blend: {
+            glm::vec3 center = glm::vec3(model * glm::vec4((mesh.boundsMin + mesh.boundsMax) * 0.5f, 1.0f));
+            glm::vec3 toCamera = center - cameraPos;
+            blendedByDepth.push_back(std::make_pair(glm::dot(toCamera, toCamera), &mesh));
+            break;
+        }
+        }
+    }
+
+    // Od najdalszego do najbliższego
+    std::sort(blendedByDepth.begin(), blendedByDepth.end(),
+              [](const std::pair<float, Mesh*>& a, const std::pair<float, Mesh*>& b) { return a.first > b.first; });
+    for (const auto& entry : blendedByDepth) {
+        queues.blended.push_back(entry.second);
+    }
+}
+
+// Najbliższy trójkąt pod promieniem (dir znormalizowany). Drzewo AABB wybiera instancje,
+// promień przechodzi do przestrzeni lokalnej submesha - parametr t zostaje ten sam.
+bool Model::pick(const glm::vec3& origin, const glm::vec3& dir, PickHit& hit) const {
+    hit = PickHit();
+    float bestT = 1e30f;
+    spatialIndex.raycast(origin, dir, bestT, [&](int index, float tEnter) {
+        const Mesh& mesh = meshes[index];
+        if (!mesh.bvh || tEnter >= bestT) return bestT;
+        glm::mat4 toLocal = glm::inverse(graph.world[mesh.node]);
+        glm::vec3 localOrigin = glm::vec3(toLocal * glm::vec4(origin, 1.0f));
+        glm::vec3 localDir = glm::vec3(toLocal * glm::vec4(dir, 0.0f));
+        if (mesh.bvh->intersect(localOrigin, localDir, bestT, hit.triangle, hit.u, hit.v)) {
+            hit.mesh = index;
+            hit.t = bestT;
+        }
+        return bestT;
+    });
+    return hit.mesh >= 0;
+}
+
+// Kamera na wysięgniku: długość ramienia skrócona do pierwszej przeszkody między celem
+// a kamerą. Pudełka zawierające cel pomijamy - to bryła, wokół której krąży kamera.
+float Model::sweepCamera(const glm::vec3& target, const glm::vec3& dir, float armLength) const {
+    const float clearance = 0.2f;  // zapas na bliską płaszczyznę obcinania
+    float length = armLength;
+    spatialIndex.raycast(target, dir, armLength, [&](int index, float tEnter) {
+        const Mesh& mesh = meshes[index];
+        Aabb box = worldBounds(mesh, graph.world[mesh.node]);
+        if (box.contains(target) || tEnter <= 0.0f) return armLength;
+        length = std::min(length, tEnter);
+        return length;
+    });
+    return (length < armLength) ? std::max(length - clearance, clearance) : armLength;
+}
+
+// Przybliżona średnica submesha na ekranie w pikselach (sfera otaczająca AABB)
+float projectedSizePixels(const Mesh& mesh, const glm::vec3& cameraPos, float viewportHeight, float fovY) {
+    const glm::mat4& model = *mesh.world;
+    glm::vec3 center = glm::vec3(model * glm::vec4((mesh.boundsMin + mesh.boundsMax) * 0.5f, 1.0f));
+    float radius = glm::length(glm::vec3(model * glm::vec4((mesh.boundsMax - mesh.boundsMin) * 0.5f, 0.0f)));
+    float distance = std::max(glm::length(center - cameraPos), radius);
+    return radius / (distance * std::tan(fovY * 0.5f)) * viewportHeight;
+}
+
+// MVP i Model ustawiane są przy zmianie węzła; submeshe jednego węzła idą bez uniformów
+void setMeshMatrices(GLuint prog, const glm::mat4& viewProjection, const glm::mat4& world) {
+    glm::mat4 mvp = viewProjection * world;
+    const ProgramUniforms& uniforms = uniformsOf(prog);
+    glUniformMatrix4fv(uniforms.mvp, 1, GL_FALSE, glm::value_ptr(mvp));
+    glUniformMatrix4fv(uniforms.model, 1, GL_FALSE, glm::value_ptr(world));
+}
+
+void Model::cleanup() {
+    for (auto& mesh : meshes) {
+        mesh.cleanup();
+    }
+    meshes.clear();
+    graph.clear();
+    spatialIndex.clear();
+    if (textureArray) {
+        resourceTracker.release(GpuResource::Texture, textureArray);
+        glDeleteTextures(1, &textureArray);
+    }
+    textureArray = 0;
+    textureArrayMasked = false;
+}
+
+MemoryUsage Model::memoryUsage() const {
+    MemoryUsage usage;
+    std::set<GLuint> textures;
+    for (const Mesh& mesh : meshes) {
+        if (mesh.ownsBuffers) {
+            usage.vertexBytes += resourceTracker.bytes(GpuResource::VertexBuffer, mesh.vbo);
+            usage.indexBytes += resourceTracker.bytes(GpuResource::IndexBuffer, mesh.ibo);
+        }
+        for (GLuint tex : {mesh.material.diffuse, mesh.material.specular, mesh.material.normal, mesh.material.emissive}) {
+            if (tex) textures.insert(tex);
+        }
+    }
+    if (textureArray) textures.insert(textureArray);
+    for (GLuint tex : textures) {
+        usage.textureBytes += resourceTracker.bytes(GpuResource::Texture, tex);
+    }
+    return usage;
+}
 
-        glGenBuffers(1, &newMesh.ibo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, newMesh.ibo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+// Deklaracja globalnego obiektu modelu
+Model harpyModel;
 
-        newMesh.indexCount = indices.size();
-        newMesh.material = loadMaterial(scene, mesh, textureDir);
-        meshes.push_back(newMesh);
+// Całość GPU według rodzaju, heap C++ ze szczytem od ostatniego importu (z -DHEAP_STATS),
+// model i jego największe submeshe
+void dumpMemory() {
+    std::cout << "--- Pamiec ---\n";
+    std::cout << "GPU: " << resourceTracker.totalGpu() / 1024 << " KB (";
+    for (int kind = 0; kind < (int)GpuResource::Count; ++kind) {
+        std::cout << (kind ? ", " : "") << gpuResourceNames[kind] << " "
+                  << resourceTracker.total((GpuResource)kind) / 1024 << " KB";
+    }
+    std::cout << ")\n";
+#ifdef HEAP_STATS
+    std::cout << "Heap C++: " << heapBytes / 1024 << " KB, szczyt od importu " << heapPeakBytes / 1024 << " KB\n";
+#endif
+
+    MemoryUsage model = harpyModel.memoryUsage();
+    std::cout << "Model: " << model.total() / 1024 << " KB (VBO " << model.vertexBytes / 1024 << " KB, IBO "
+              << model.indexBytes / 1024 << " KB, tekstury " << model.textureBytes / 1024 << " KB), "
+              << harpyModel.meshes.size() << " submeshy\n";
+
+    std::vector<size_t> order;
+    for (size_t i = 0; i < harpyModel.meshes.size(); ++i) {
+        if (harpyModel.meshes[i].ownsBuffers) order.push_back(i);
+    }
+    auto geometryBytes = [](const Mesh& mesh) {
+        MemoryUsage usage = mesh.memoryUsage();
+        return usage.vertexBytes + usage.indexBytes;
+    };
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return geometryBytes(harpyModel.meshes[a]) > geometryBytes(harpyModel.meshes[b]);
+    });
+    for (size_t k = 0; k < std::min<size_t>(order.size(), 5); ++k) {
+        const Mesh& mesh = harpyModel.meshes[order[k]];
+        MemoryUsage usage = mesh.memoryUsage();
+        std::cout << "  submesh " << order[k] << " (" << harpyModel.graph.names[mesh.node] << "): VBO "
+                  << usage.vertexBytes / 1024 << " KB, IBO " << usage.indexBytes / 1024 << " KB, tekstury "
+                  << usage.textureBytes / 1024 << " KB\n";
+    }
+}
+
+// Promień z kamery przez punkt ekranu (jednostki okna), na macierzy ostatniej klatki
+void screenRay(float x, float y, glm::vec3& origin, glm::vec3& dir) {
+    glm::mat4 inverse = glm::inverse(lastViewProjection);
+    float ndcX = 2.0f * x / (float)windowWidth - 1.0f;
+    float ndcY = 1.0f - 2.0f * y / (float)windowHeight;
+    glm::vec4 nearPoint = inverse * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverse * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+    origin = glm::vec3(nearPoint) / nearPoint.w;
+    dir = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+}
+
+bool pickAt(float x, float y, PickHit& hit) {
+    glm::vec3 origin, dir;
+    screenRay(x, y, origin, dir);
+    return harpyModel.pick(origin, dir, hit);
+}
+
+#ifdef PICK_BENCH
+// Model::pick (drzewo AABB + BVH) kontra pełny przegląd wszystkich trójkątów wszystkich
+// instancji. Promienie z losowych punktów sfery wokół modelu w losowe punkty jego pudełka;
+// trafienie musi być to samo (ten sam trójkąt albo ta sama odległość przy remisie).
+void benchmarkPick(const Model& model) {
+    Aabb bounds;
+    for (const Mesh& mesh : model.meshes) bounds = mergeAabb(bounds, worldBounds(mesh, model.graph.world[mesh.node]));
+    if (model.meshes.empty()) return;
+    glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+    float radius = glm::length(bounds.max - bounds.min);
+
+    uint32_t seed = 12345;
+    auto random = [&]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (float)(seed >> 8) / 16777216.0f;
+    };
+    auto randomIn = [&](const glm::vec3& lo, const glm::vec3& hi) {
+        return glm::vec3(lo.x + (hi.x - lo.x) * random(), lo.y + (hi.y - lo.y) * random(), lo.z + (hi.z - lo.z) * random());
+    };
+
+    const int rays = 2000;
+    int hits = 0, mismatches = 0;
+    double pickUs = 0.0, bruteUs = 0.0;
+    for (int r = 0; r < rays; ++r) {
+        glm::vec3 origin = center + glm::normalize(randomIn(glm::vec3(-1.0f), glm::vec3(1.0f)) + glm::vec3(1e-6f)) * radius;
+        glm::vec3 dir = glm::normalize(randomIn(bounds.min, bounds.max) - origin);
+
+        auto start = std::chrono::steady_clock::now();
+        PickHit hit;
+        bool found = model.pick(origin, dir, hit);
+        auto mid = std::chrono::steady_clock::now();
+
+        float bestT = 1e30f;
+        int bestMesh = -1;
+        unsigned int bestTriangle = 0;
+        for (size_t i = 0; i < model.meshes.size(); ++i) {
+            const Mesh& mesh = model.meshes[i];
+            if (!mesh.bvh) continue;
+            glm::mat4 toLocal = glm::inverse(model.graph.world[mesh.node]);
+            glm::vec3 localOrigin = glm::vec3(toLocal * glm::vec4(origin, 1.0f));
+            glm::vec3 localDir = glm::vec3(toLocal * glm::vec4(dir, 0.0f));
+            if (mesh.bvh->intersectBruteForce(localOrigin, localDir, bestT, bestTriangle)) bestMesh = (int)i;
+        }
+        auto end = std::chrono::steady_clock::now();
+        pickUs += std::chrono::duration<double, std::micro>(mid - start).count();
+        bruteUs += std::chrono::duration<double, std::micro>(end - mid).count();
+
+        bool same = found == (bestMesh >= 0);
+        if (same && found) {
+            bool sameTriangle = hit.mesh == bestMesh && hit.triangle == bestTriangle;
+            same = sameTriangle || std::fabs(hit.t - bestT) <= 1e-5f * std::max(1.0f, bestT);
+        }
+        hits += found;
+        mismatches += !same;
+    }
+    std::cout << "Wybor promieniem: " << rays << " promieni, " << hits << " trafien, " << mismatches
+              << " rozbieznosci z pelnym przegladem; pick " << pickUs / rays << " us, pelny przeglad " << bruteUs / rays
+              << " us na promien\n";
+}
+#endif
+
+void selectAt(float x, float y) {
+    auto start = std::chrono::steady_clock::now();
+    PickHit hit;
+    bool found = pickAt(x, y, hit);
+    std::chrono::duration<double, std::micro> us = std::chrono::steady_clock::now() - start;
+    if (found) {
+        selectedMesh = hit.mesh;
+        std::cout << "Wybrano submesh " << hit.mesh << ", trojkat " << hit.triangle << " (u " << hit.u << ", v " << hit.v
+                  << ", odleglosc " << hit.t << ") w " << us.count() << " us\n";
+    } else {
+        selectedMesh = -1;
+    }
+}
+
+// Gest krótszy niż kilka pikseli to tapnięcie, nie obrót kamery
+bool isTap(float x, float y) {
+    return std::fabs(x - gesture.pressX) < 6.0f && std::fabs(y - gesture.pressY) < 6.0f;
+}
+
+// --- Dynamiczna rozdzielczość ---
+// Scena rysowana jest do FBO w rozdzielczości drawable * scale, a potem rozciągana
+// na ekran jednym trójkątem. Tekstura ma rozmiar dla scale = 1, więc zmiana skali
+// zmienia tylko viewport, bez realokacji. Skalę i rozmiar wyjścia prowadzi symulacja;
+// begin()/present() dostają je z nagranej klatki i wołane są w wątku GL.
+const char* vsPresent = R"(
+attribute vec2 aPos;
+varying vec2 vUV;
+
+void main() {
+    vUV = aPos * 0.5 + 0.5;
+    gl_Position = vec4(aPos, 0.0, 1.0);
+}
+)";
+
+const char* fsPresent = R"(
+precision mediump float;
+
+uniform sampler2D frame;
+uniform vec2 renderSize;   // część tekstury zajęta przez obraz, w pikselach
+uniform vec2 textureSize;
+varying vec2 vUV;
+
+void main() {
+    // Środki skrajnych pikseli obrazu - filtr liniowy nie sięga poza wyrenderowany obszar
+    vec2 uv = (vUV * (renderSize - 1.0) + 0.5) / textureSize;
+    gl_FragColor = texture2D(frame, uv);
+}
+)";
+
+class DynamicResolution {
+public:
+    float scale = 1.0f;
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    double targetMs = 1000.0 / 60.0;
+    size_t sampleWindow = 30;   // tyle kolejnych klatek na jedną decyzję kontrolera
+
+    void init();
+    void setOutputSize(int width, int height);
+    void begin(int width, int height, int outputWidth, int outputHeight);
+    void present(int width, int height);
+    void update();   // wątek główny: przekazuje kontrolerowi czasy zmierzone przez wątek GL
+    void recordFrame(double frameMs);
+    int renderWidth() const { return std::max(1, (int)(outputWidth * scale + 0.5f)); }
+    int renderHeight() const { return std::max(1, (int)(outputHeight * scale + 0.5f)); }
+    void cleanup();
+
+private:
+    GLuint fbo = 0, color = 0, depth = 0;
+    GLuint program = 0, triangle = 0;
+    int outputWidth = 0, outputHeight = 0;
+    int targetWidth = 0, targetHeight = 0;   // rozmiar tekstury i bufora głębokości (wątek GL)
+    GLenum depthFormat = GL_DEPTH_COMPONENT16;
+    GLenum depthAttachment = GL_DEPTH_ATTACHMENT;
+    size_t depthBytes = 2;
+    std::vector<double> samples;
+
+    // Czas pracy klatki od begin() do końca present(), bez czekania na vsync w SwapWindow.
+    // Z EXT_disjoint_timer_query mierzy GPU (wyniki wracają po kilku klatkach), bez niego CPU.
+    static const GLenum TIME_ELAPSED = 0x88BF;   // GL_TIME_ELAPSED_EXT
+    static const GLenum GPU_DISJOINT = 0x8FBB;   // GL_GPU_DISJOINT_EXT
+    static const int queryCount = 4;
+    bool timerQueries = false;
+    GLuint queries[queryCount] = {};
+    int queryHead = 0, queryPending = 0;
+    bool queryActive = false;
+    double workStart = 0.0;
+    std::mutex measuredLock;
+    std::vector<double> measured;   // wątek GL dopisuje, update() zabiera
+
+    void allocate(int width, int height);
+    void beginTiming();
+    void endTiming();
+    void pushMeasured(double frameMs);
+};
+
+DynamicResolution dynamicResolution;
+
+void DynamicResolution::init() {
+    program = createProgram(vsPresent, fsPresent);
+    const float corners[] = {-1.0f, -1.0f, 3.0f, -1.0f, -1.0f, 3.0f};
+    glGenBuffers(1, &triangle);
+    glBindBuffer(GL_ARRAY_BUFFER, triangle);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Głębia 24-bitowa jak w domyślnym framebufferze: rdzeń GLES3/WebGL2, OES_depth24 w GLES2.
+    // WebGL1 daje 24 bity tylko razem ze stencilem (DEPTH_STENCIL), inaczej zostaje 16.
+    std::set<std::string> extensions = glExtensions();
+    if (renderBackend == RenderBackend::GLES3 || extensions.count("OES_depth24")) {
+        depthFormat = GL_DEPTH_COMPONENT24;
+        depthBytes = 4;
+    }
+#ifdef __EMSCRIPTEN__
+    else {
+        depthFormat = GL_DEPTH_STENCIL;
+        depthAttachment = GL_DEPTH_STENCIL_ATTACHMENT;
+        depthBytes = 4;
+    }
+#endif
+
+    // glBeginQuery jest w rdzeniu GLES3; w GLES2 zostaje pomiar CPU
+    timerQueries = renderBackend == RenderBackend::GLES3 &&
+                   (extensions.count("EXT_disjoint_timer_query_webgl2") || extensions.count("EXT_disjoint_timer_query"));
+    if (timerQueries) glGenQueries(queryCount, queries);
+    std::cout << "Czas klatki dla dynamicznej rozdzielczosci: "
+              << (timerQueries ? "GPU (zapytania czasowe)" : "CPU (bez czekania na vsync)") << ", glebia "
+              << (depthBytes == 4 ? 24 : 16) << " bit\n";
+}
+
+void DynamicResolution::setOutputSize(int width, int height) {
+    if (width == outputWidth && height == outputHeight) return;
+    outputWidth = width;
+    outputHeight = height;
+    std::cout << "Ekran: " << width << "x" << height << ", renderowanie " << renderWidth() << "x" << renderHeight() << "\n";
+}
+
+void DynamicResolution::allocate(int width, int height) {
+    targetWidth = width;
+    targetHeight = height;
+
+    if (!fbo) {
+        glGenFramebuffers(1, &fbo);
+        glGenTextures(1, &color);
+        glGenRenderbuffers(1, &depth);
+    }
+    // Bez mipmap i z CLAMP_TO_EDGE - WebGL1 przyjmuje wtedy teksturę NPOT
+    glBindTexture(GL_TEXTURE_2D, color);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, depthFormat, width, height);
+    resourceTracker.record(GpuResource::Texture, color, (size_t)width * height * 4);
+    resourceTracker.record(GpuResource::Renderbuffer, depth, (size_t)width * height * depthBytes);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, depthAttachment, GL_RENDERBUFFER, depth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Niekompletny FBO dynamicznej rozdzielczosci " << width << "x" << height << "\n";
     }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void DynamicResolution::begin(int width, int height, int outputWidth, int outputHeight) {
+    beginTiming();
+    if (outputWidth != targetWidth || outputHeight != targetHeight) allocate(outputWidth, outputHeight);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
 }
 
-void Model::render(GLuint program) {
+void DynamicResolution::present(int width, int height) {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, targetWidth, targetHeight);
+    glDisable(GL_DEPTH_TEST);
+
     glUseProgram(program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, color);
+    const ProgramUniforms& uniforms = uniformsOf(program);
+    glUniform2f(uniforms.renderSize, (float)width, (float)height);
+    glUniform2f(uniforms.textureSize, (float)targetWidth, (float)targetHeight);
 
-    for (auto& mesh : meshes) {
-        mesh.render(program);
+    glBindBuffer(GL_ARRAY_BUFFER, triangle);
+    glEnableVertexAttribArray(ATTR_POS);
+    glVertexAttribPointer(ATTR_POS, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glDisableVertexAttribArray(ATTR_POS);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glEnable(GL_DEPTH_TEST);
+    endTiming();
+}
+
+void DynamicResolution::beginTiming() {
+    if (!timerQueries) {
+        workStart = platformNow();
+        return;
+    }
+    // Odbieramy gotowe wyniki, najstarsze najpierw. Wynik to nanosekundy w 32 bitach (do ~4 s).
+    while (queryPending > 0) {
+        GLuint query = queries[(queryHead + queryCount - queryPending) % queryCount];
+        GLuint available = 0;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+        GLuint elapsedNs = 0;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT, &elapsedNs);
+        --queryPending;
+        // Zmiana taktowania lub przełączenie GPU w trakcie pomiaru - wynik bez znaczenia
+        GLint disjoint = 0;
+        glGetIntegerv(GPU_DISJOINT, &disjoint);
+        if (!disjoint) pushMeasured(elapsedNs / 1.0e6);
     }
+    // Wszystkie zapytania wciąż w drodze - tę klatkę pomijamy
+    queryActive = queryPending < queryCount;
+    if (queryActive) glBeginQuery(TIME_ELAPSED, queries[queryHead]);
 }
 
-void Model::cleanup() {
-    for (auto& mesh : meshes) {
-        mesh.cleanup();
+void DynamicResolution::endTiming() {
+    if (!timerQueries) {
+        pushMeasured((platformNow() - workStart) * 1000.0);
+        return;
     }
-    meshes.clear();
+    if (!queryActive) return;
+    glEndQuery(TIME_ELAPSED);
+    queryHead = (queryHead + 1) % queryCount;
+    ++queryPending;
+    queryActive = false;
 }
 
-// Deklaracja globalnego obiektu modelu
-Model harpyModel;
+void DynamicResolution::pushMeasured(double frameMs) {
+    std::lock_guard<std::mutex> guard(measuredLock);
+    measured.push_back(frameMs);
+}
+
+void DynamicResolution::update() {
+    std::vector<double> ready;
+    {
+        std::lock_guard<std::mutex> guard(measuredLock);
+        ready.swap(measured);
+    }
+    for (double ms : ready) recordFrame(ms);
+}
+
+// Średnia z sampleWindow kolejnych klatek. Czas pracy nie zawiera czekania na vsync, więc
+// powyżej 90% budżetu zmniejszamy skalę, a poniżej 70% (+10% pikseli po kroku 1.05) zwiększamy.
+void DynamicResolution::recordFrame(double frameMs) {
+    samples.push_back(frameMs);
+    if (samples.size() < sampleWindow) return;
+
+    double average = 0.0;
+    for (double ms : samples) average += ms;
+    average /= samples.size();
+    samples.clear();
+
+    float previous = scale;
+    if (average > targetMs * 0.9) {
+        scale = std::max(minScale, scale * 0.9f);
+    } else if (average < targetMs * 0.7) {
+        scale = std::min(maxScale, scale * 1.05f);
+    }
+    if (scale != previous) {
+        std::cout << "Rozdzielczosc renderowania: " << (int)(scale * 100.0f + 0.5f) << "% (" << renderWidth() << "x"
+                  << renderHeight() << "), sredni czas pracy klatki " << average << " ms\n";
+    }
+}
+
+void DynamicResolution::cleanup() {
+    resourceTracker.release(GpuResource::Texture, color);
+    resourceTracker.release(GpuResource::Renderbuffer, depth);
+    if (timerQueries) glDeleteQueries(queryCount, queries);
+    timerQueries = false;
+    queryPending = 0;
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &color);
+    glDeleteRenderbuffers(1, &depth);
+    glDeleteBuffers(1, &triangle);
+    deleteProgram(program);
+    fbo = color = depth = triangle = program = 0;
+    targetWidth = targetHeight = 0;
+}
+
+void updateWindowSize() {
+    SDL_GetWindowSize(window, &windowWidth, &windowHeight);
+    SDL_GL_GetDrawableSize(window, &drawableWidth, &drawableHeight);
+    dynamicResolution.setOutputSize(drawableWidth, drawableHeight);
+}
+
+// --- Bufor poleceń renderowania ---
+// render() tylko nagrywa klatkę: macierze, kolejki rysowania, stan GL i zapotrzebowanie
+// na tekstury trafiają do FrameCommands jako zwykłe dane. Wykonuje je executeFrame() -
+// w pętli to jedyne miejsce z wywołaniami GL - w osobnym wątku, który jest właścicielem
+// kontekstu. Dwa bufory: symulacja nagrywa klatkę N+1, gdy wątek GL wysyła klatkę N.
+enum class RenderOp : uint8_t {
+    Depth,   // funkcja głębokości i maski zapisu
+    Blend,   // blendSrc == 0 wyłącza mieszanie
+    Draw     // items[first, first + count)
+};
+
+struct RenderCommand {
+    RenderOp op = RenderOp::Draw;
+    GLenum depthFunc = GL_LESS;
+    bool depthWrite = true;
+    bool colorWrite = true;
+    GLenum blendSrc = 0, blendDst = 0;
+    GLuint program = 0;          // 0 = wariant shadera według materiału każdego mesha
+    bool withMaterial = false;
+    uint32_t first = 0, count = 0;
+};
+
+struct DrawItem {
+    Mesh* mesh;
+    uint32_t world;   // indeks w FrameCommands::worlds
+};
+
+struct FrameCommands {
+    glm::vec4 clearColor = glm::vec4(0.0f);
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    glm::vec3 cameraPos = glm::vec3(0.0f);
+    const Mesh* selected = nullptr;    // podświetlany w przebiegach z materiałem
+    int renderWidth = 1, renderHeight = 1;
+    int outputWidth = 1, outputHeight = 1;
+
+    std::vector<glm::mat4> worlds;     // kopie macierzy węzłów - graf może już liczyć następną klatkę
+    std::vector<DrawItem> items;
+    std::vector<RenderCommand> commands;
+    std::vector<std::pair<const Material*, float>> residency;   // piksele na ekranie dla streamera
+
+    void clear() {
+        worlds.clear();
+        items.clear();
+        commands.clear();
+        residency.clear();
+    }
+
+    void setDepth(GLenum func, bool depthWrite, bool colorWrite) {
+        RenderCommand c;
+        c.op = RenderOp::Depth;
+        c.depthFunc = func;
+        c.depthWrite = depthWrite;
+        c.colorWrite = colorWrite;
+        commands.push_back(c);
+    }
+
+    void setBlend(GLenum src, GLenum dst) {
+        RenderCommand c;
+        c.op = RenderOp::Blend;
+        c.blendSrc = src;
+        c.blendDst = dst;
+        commands.push_back(c);
+    }
+
+    // Kolejne meshe tego samego węzła dzielą jedną kopię macierzy
+    void draw(const std::vector<Mesh*>& queue, GLuint program, bool withMaterial) {
+        if (queue.empty()) return;
+        RenderCommand c;
+        c.program = program;
+        c.withMaterial = withMaterial;
+        c.first = (uint32_t)items.size();
+        c.count = (uint32_t)queue.size();
+        const glm::mat4* current = nullptr;
+        for (Mesh* mesh : queue) {
+            if (mesh->world != current) {
+                worlds.push_back(*mesh->world);
+                current = mesh->world;
+            }
+            items.push_back({mesh, (uint32_t)worlds.size() - 1});
+        }
+        commands.push_back(c);
+    }
+};
+
+// Wybrany submesh dostaje Highlight = 1 tylko na czas swojego wywołania
+void renderHighlighted(const FrameCommands& frame, Mesh* mesh, GLuint program, unsigned features) {
+    bool selected = mesh == frame.selected;
+    if (selected) glUniform1f(uniformsOf(program).highlight, 1.0f);
+    mesh->render(program, features);
+    if (selected) glUniform1f(uniformsOf(program).highlight, 0.0f);
+}
+
+void drawItems(const FrameCommands& frame, const RenderCommand& c) {
+    glUseProgram(c.program);
+    uint32_t currentWorld = UINT32_MAX;
+    for (uint32_t i = c.first; i < c.first + c.count; ++i) {
+        const DrawItem& item = frame.items[i];
+        if (item.world != currentWorld) {
+            setMeshMatrices(c.program, frame.viewProjection, frame.worlds[item.world]);
+            currentWorld = item.world;
+        }
+        if (c.withMaterial) {
+            renderHighlighted(frame, item.mesh, c.program, 0);
+        } else {
+            item.mesh->renderGeometry(c.program);
+        }
+    }
+}
+
+// Każdy mesh dostaje wariant według swoich slotów; program (i uniformy) zmieniamy
+// tylko wtedy, gdy kolejny mesh potrzebuje innego wariantu
+void drawMaterialItems(const FrameCommands& frame, const RenderCommand& c) {
+    GLuint current = 0;
+    uint32_t currentWorld = UINT32_MAX;
+    for (uint32_t i = c.first; i < c.first + c.count; ++i) {
+        const DrawItem& item = frame.items[i];
+        unsigned features = item.mesh->shaderFeatures();
+        GLuint prog = shaderVariant(features);
+        if (prog != current) {
+            glUseProgram(prog);
+            glUniform3fv(uniformsOf(prog).cameraPos, 1, glm::value_ptr(frame.cameraPos));
+            current = prog;
+            currentWorld = UINT32_MAX;
+        }
+        if (item.world != currentWorld) {
+            setMeshMatrices(prog, frame.viewProjection, frame.worlds[item.world]);
+            currentWorld = item.world;
+        }
+        renderHighlighted(frame, item.mesh, prog, features);
+    }
+}
+
+// Zwraca true, gdy streamer podmienił poziomy tekstur i potrzebna jest kolejna klatka
+bool executeFrame(const FrameCommands& frame) {
+    dynamicResolution.begin(frame.renderWidth, frame.renderHeight, frame.outputWidth, frame.outputHeight);
+    glClearColor(frame.clearColor.x, frame.clearColor.y, frame.clearColor.z, frame.clearColor.w);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Streamer (uploady tekstur) należy do wątku GL
+    for (const auto& request : frame.residency) {
+        request.first->requestResidency(request.second);
+    }
+    bool streaming = textureStreamer.update();
+
+    for (const RenderCommand& c : frame.commands) {
+        switch (c.op) {
+        case RenderOp::Depth:
+            glDepthFunc(c.depthFunc);
+            glDepthMask(c.depthWrite ? GL_TRUE : GL_FALSE);
+            glColorMask(c.colorWrite, c.colorWrite, c.colorWrite, c.colorWrite);
+            break;
+        case RenderOp::Blend:
+            if (c.blendSrc) {
+                glEnable(GL_BLEND);
+                glBlendFunc(c.blendSrc, c.blendDst);
+            } else {
+                glDisable(GL_BLEND);
+            }
+            break;
+        case RenderOp::Draw:
+            if (c.program) {
+                drawItems(frame, c);
+            } else {
+                drawMaterialItems(frame, c);
+            }
+            break;
+        }
+    }
+
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDisable(GL_BLEND);
+    dynamicResolution.present(frame.renderWidth, frame.renderHeight);
+    SDL_GL_SwapWindow(window);
+    return streaming;
+}
+
+// --- Wątek renderujący ---
+// Natywnie kontekst GL przechodzi do osobnego wątku przy pierwszej klatce (po ustawieniu
+// vsync w platformRun). W przeglądarce kontekst WebGL z SDL należy do głównego wątku,
+// więc tam klatka jest wykonywana od razu po nagraniu - ten sam bufor, bez nakładania.
+#ifndef __EMSCRIPTEN__
+#define RENDER_THREAD 1
+#endif
+
+class RenderThread {
+public:
+    FrameCommands& recording() { return buffers[writeIndex]; }
+    void submit();
+    void stop();
+    // true, jeśli streamer tekstur prosi o kolejną klatkę
+    bool takeStreamingRequest() { return streamingPending.exchange(false); }
+
+private:
+    FrameCommands buffers[2];
+    int writeIndex = 0;
+    std::atomic<bool> streamingPending{false};
+
+#ifdef RENDER_THREAD
+    std::thread thread;
+    std::mutex stateLock;
+    std::condition_variable wake;    // symulacja -> wątek GL: jest klatka albo koniec
+    std::condition_variable ready;   // wątek GL -> symulacja: bufor odebrany albo zwolniony
+    const FrameCommands* queued = nullptr;
+    const FrameCommands* executing = nullptr;
+    bool running = false;
+    bool stopping = false;
+
+    void loop();
+#endif
+};
+
+RenderThread renderThread;
+
+#ifdef RENDER_THREAD
+void RenderThread::loop() {
+    SDL_GL_MakeCurrent(window, glContext);
+    std::unique_lock<std::mutex> guard(stateLock);
+    while (true) {
+        wake.wait(guard, [&] { return stopping || queued; });
+        if (!queued) break;
+        executing = queued;
+        queued = nullptr;
+        ready.notify_all();
+
+        guard.unlock();
+        if (executeFrame(*executing)) streamingPending = true;
+        guard.lock();
+
+        executing = nullptr;
+        ready.notify_all();
+    }
+    SDL_GL_MakeCurrent(window, nullptr);
+}
+#endif
+
+void RenderThread::submit() {
+    FrameCommands& frame = buffers[writeIndex];
+#ifdef RENDER_THREAD
+    if (!running) {
+        SDL_GL_MakeCurrent(window, nullptr);
+        running = true;
+        thread = std::thread(&RenderThread::loop, this);
+    }
+    std::unique_lock<std::mutex> guard(stateLock);
+    // Najwyżej jedna klatka w kolejce - symulacja nie ucieka wątkowi GL
+    ready.wait(guard, [&] { return queued == nullptr; });
+    queued = &frame;
+    wake.notify_all();
+
+    // Drugi bufor może jeszcze być wykonywany (klatka N) - nagrywanie do niego dopiero po nim
+    writeIndex ^= 1;
+    ready.wait(guard, [&] { return executing != &buffers[writeIndex]; });
+#else
+    if (executeFrame(frame)) streamingPending = true;
+#endif
+}
+
+// Czeka na wysłanie ostatniej klatki i oddaje kontekst GL wątkowi głównemu
+void RenderThread::stop() {
+#ifdef RENDER_THREAD
+    if (!running) return;
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    thread.join();
+    running = false;
+    stopping = false;
+    SDL_GL_MakeCurrent(window, glContext);
+#endif
+}
 
 // --- Funkcje główne programu ---
 bool init() {
@@ -341,57 +4341,91 @@ bool init() {
         std::cerr << "SDL_Init Error: " << SDL_GetError() << "\n";
         return false;
     }
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
 
-    window = SDL_CreateWindow("Model Loader", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 640, 480, SDL_WINDOW_OPENGL);
+    window = SDL_CreateWindow("Model Loader", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, windowWidth, windowHeight,
+                              SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
     if (!window) {
         std::cerr << "SDL_CreateWindow Error: " << SDL_GetError() << "\n";
         return false;
     }
+
+    // Najpierw WebGL2/GLES3, a gdy się nie da - WebGL1/GLES2
     glContext = SDL_GL_CreateContext(window);
+    if (!glContext) {
+        std::cerr << "Brak kontekstu GLES3 (" << SDL_GetError() << "), probuje GLES2\n";
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
+        glContext = SDL_GL_CreateContext(window);
+    }
     if (!glContext) {
         std::cerr << "SDL_GL_CreateContext Error: " << SDL_GetError() << "\n";
         return false;
     }
+    const char* version = (const char*)glGetString(GL_VERSION);
+    if (version && std::string(version).find("OpenGL ES 3") != std::string::npos) {
+        renderBackend = RenderBackend::GLES3;
+    }
+    std::cout << "Kontekst: " << (version ? version : "?") << ", backend "
+              << (renderBackend == RenderBackend::GLES3 ? "GLES3 (tablica tekstur)" : "GLES2") << "\n";
 
-    glViewport(0, 0, 640, 480);
+    dynamicResolution.init();
+    updateWindowSize();
     glClearColor(0.2f, 0.9f, 0.2f, 1.0f);
     glEnable(GL_DEPTH_TEST);
 
-    int imgFlags = IMG_INIT_PNG | IMG_INIT_JPG;
-    if (!(IMG_Init(imgFlags) & imgFlags)) {
-        std::cerr << "SDL_image Error: " << IMG_GetError() << "\n";
-        return false;
+    depthProgram = createProgram(vs, fsDepth);
+    overdrawProgram = createProgram(vs, fsOverdraw);
+    detectCompressedFormats();
+    shaderVariant(0);  // podstawowy wariant od razu, reszta przy pierwszym materiale, który jej użyje
+    depthProgramMasked = createProgram(vs, fsDepth, "#define ALPHA_MASK\n");
+    if (renderBackend == RenderBackend::GLES3) {
+        arrayProgram = createProgram(vsArray, fsArray);
+        arrayDepthProgram = createProgram(vsArray, fsArrayDepth);
+        arrayProgramMasked = createProgram(vsArray, fsArray, "#define ALPHA_MASK\n");
+        arrayDepthProgramMasked = createProgram(vsArray, fsArrayDepth, "#define ALPHA_MASK\n");
     }
 
-    GLuint vsId = compileShader(GL_VERTEX_SHADER, vs);
-    GLuint fsId = compileShader(GL_FRAGMENT_SHADER, fs);
-    program = glCreateProgram();
-    glAttachShader(program, vsId);
-    glAttachShader(program, fsId);
-    glLinkProgram(program);
-
-    uniformMVPLoc = glGetUniformLocation(program, "MVP");
-    uniformModelLoc = glGetUniformLocation(program, "Model");
-
     return true;
 }
 
 void cleanup() {
+    renderThread.stop();
+    textureStreamer.clear();
     harpyModel.cleanup();
+    releaseTextureCache();
+    releaseShaderVariants();
+    deleteProgram(depthProgram);
+    deleteProgram(overdrawProgram);
+    deleteProgram(depthProgramMasked);
+    deleteProgram(arrayProgram);
+    deleteProgram(arrayDepthProgram);
+    deleteProgram(arrayProgramMasked);
+    deleteProgram(arrayDepthProgramMasked);
+    dynamicResolution.cleanup();
     SDL_GL_DeleteContext(glContext);
     SDL_DestroyWindow(window);
     SDL_Quit();
-    IMG_Quit();
 }
 
+// Nagrywa klatkę (macierze, culling, kolejki) i oddaje ją wątkowi GL
 void render() {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glUseProgram(program);
+    FrameCommands& frame = renderThread.recording();
+    frame.clear();
+    frame.renderWidth = dynamicResolution.renderWidth();
+    frame.renderHeight = dynamicResolution.renderHeight();
+    frame.outputWidth = drawableWidth;
+    frame.outputHeight = drawableHeight;
+
+    // W widoku overdraw czarne tło, żeby było widać sumowanie warstw
+    if (overdrawView) {
+        frame.clearColor = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    } else {
+        frame.clearColor = glm::vec4(0.2f, 0.9f, 0.2f, 1.0f);
+    }
 
     // 1. Obliczenie macierzy projekcji
-    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 640.0f / 480.0f, 0.1f, 100.0f);
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)drawableWidth / (float)drawableHeight, 0.1f, 100.0f);
 
     // 2. Obliczenie macierzy widoku (kluczowa część)
     glm::vec3 cameraPos = cameraTarget + glm::vec3(0.0f, 0.0f, cameraDistance);
@@ -405,212 +4439,364 @@ void render() {
     glm::vec3 cameraOffset = glm::vec3(0.0f, 0.0f, cameraDistance);
     cameraPos = cameraTarget + orientation * cameraOffset;
 
-    glm::mat4 view = glm::lookAt(cameraPos, cameraTarget, orientation * worldUp);
-//3
-    glm::mat4 model = glm::mat4(1.0f);
-
-// 👉 Przesunięcie – postać nad ziemią
-model = glm::translate(model, glm::vec3(0.0f, -0.5f, 0.0f));
+    // 3. Przeliczenie grafu sceny i indeksu przestrzennego. Ustawienie modelu w świecie to
+    //    lokalna transformacja korzenia grafu - przeliczane są tylko węzły pod zmienionym korzeniem.
+    SceneGraph::Transform placement;
+    placement.translation = glm::vec3(0.0f, -0.5f, 0.0f);  // postać nad ziemią
+    placement.rotation = glm::angleAxis(modelRotationX, glm::vec3(1.0f, 0.0f, 0.0f));
+    placement.scale = glm::vec3(0.1f);
+    harpyModel.graph.setLocal(0, placement);
+    harpyModel.updateTransforms();
 
-// 👉 Obrót wokół osi X
-model = glm::rotate(model, modelRotationX, glm::vec3(1.0f, 0.0f, 0.0f));
+    // Kamera nie wchodzi w bryły między celem a sobą
+    glm::vec3 arm = orientation * cameraOffset;
+    float armLength = glm::length(arm);
+    if (armLength > 1e-4f) {
+        glm::vec3 armDir = arm / armLength;
+        cameraPos = cameraTarget + armDir * harpyModel.sweepCamera(cameraTarget, armDir, armLength);
+    }
 
-// 👉 Skalowanie
-model = glm::scale(model, glm::vec3(0.1f));
-// 👉 Potem przesunięcie – np. żeby stał na ziemi
-model = glm::translate(model, glm::vec3(0.0f, -0.5f, 0.0f));
-   // 4. Połączenie macierzy
-    glm::mat4 mvp = projection * view * model;
+    glm::mat4 view = glm::lookAt(cameraPos, cameraTarget, orientation * worldUp);
+    glm::mat4 viewProjection = projection * view;
+    lastViewProjection = viewProjection;
+    frame.viewProjection = viewProjection;
+    frame.cameraPos = cameraPos;
+    bool validSelection = selectedMesh >= 0 && selectedMesh < (int)harpyModel.meshes.size();
+    frame.selected = validSelection ? &harpyModel.meshes[selectedMesh] : nullptr;
 
-    glUniformMatrix4fv(uniformMVPLoc, 1, GL_FALSE, glm::value_ptr(mvp));
-    glUniformMatrix4fv(uniformModelLoc, 1, GL_FALSE, glm::value_ptr(model));
+    RenderQueues queues;
+    harpyModel.buildQueues(cameraPos, viewProjection, queues);
 
-    harpyModel.render(program);
-    SDL_GL_SwapWindow(window);
-}
-void main_loop() {
-    SDL_Event e;
-    while (SDL_PollEvent(&e)) {
-        if (e.type == SDL_QUIT) {
-            emscripten_cancel_main_loop();
-        } 
-        
-        // --- Sterowanie myszą ---
-        else if (e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_LEFT) {
-            mouseDown = true;
-            lastX = e.button.x;
-            lastY = e.button.y;
-        } else if (e.type == SDL_MOUSEBUTTONUP && e.button.button == SDL_BUTTON_LEFT) {
-            mouseDown = false;
-        } else if (e.type == SDL_MOUSEMOTION && mouseDown) {
-            // TERAZ PRAWIDŁOWO: Ruch w osi X myszy (lewo/prawo) kontroluje KĄT HORYZONTALNY kamery (Yaw)
-            cameraYaw += (e.motion.x - lastX) * rotationSpeed;
-            
-            // TERAZ PRAWIDŁOWO: Ruch w osi Y myszy (góra/dół) kontroluje KĄT WERTYKALNY kamery (Pitch)
-            // Ujemny znak, aby ruch myszki w dół przesuwał kamerę w dół.
-            cameraPitch -= (e.motion.y - lastY) * rotationSpeed; 
-
-            // Ograniczenie kąta Pitch, żeby nie przechodzić "za plecy"
-            cameraPitch = glm::clamp(cameraPitch, glm::radians(-89.0f), glm::radians(89.0f));
-
-            lastX = e.motion.x;
-            lastY = e.motion.y;
-        }
-        else if (e.type == SDL_MOUSEWHEEL) {
-            // Zoom (kółko myszy)
-            if (e.wheel.y > 0) { // Przybliżanie
-                cameraDistance -= 0.5f;
-            } else if (e.wheel.y < 0) { // Oddalanie
-                cameraDistance += 0.5f;
-            }
-            // Ograniczenie odległości
-            cameraDistance = glm::clamp(cameraDistance, 1.0f, 15.0f); 
+    // Zapotrzebowanie na rozdzielczość tekstur według rozmiaru submeshy na ekranie
+    for (const auto* queue : {&queues.opaque, &queues.masked, &queues.blended}) {
+        for (Mesh* mesh : *queue) {
+            float pixels = projectedSizePixels(*mesh, cameraPos, (float)frame.renderHeight, glm::radians(45.0f));
+            frame.residency.push_back({&mesh->material, pixels});
         }
+    }
 
-        // --- Sterowanie dotykiem (dostosowane) ---
-        else if (e.type == SDL_FINGERDOWN) {
-            int numFingers = SDL_GetNumTouchFingers(e.tfinger.touchId);
-            if (numFingers == 1) { 
-                mouseDown = true;
-                lastX = e.tfinger.x * 640;
-                lastY = e.tfinger.y * 480;
-            } else if (numFingers == 2) { 
-                SDL_Finger* finger1 = SDL_GetTouchFinger(e.tfinger.touchId, 0);
-                SDL_Finger* finger2 = SDL_GetTouchFinger(e.tfinger.touchId, 1);
-                
-                if (finger1 && finger2) {
-                    float dx = (finger1->x - finger2->x) * 640;
-                    float dy = (finger1->y - finger2->y) * 480;
-                    initialFingerDistance = sqrt(dx*dx + dy*dy);
-                }
-            }
-        } else if (e.type == SDL_FINGERUP) {
-            mouseDown = false;
-        } else if (e.type == SDL_FINGERMOTION) {
-            int numFingers = SDL_GetNumTouchFingers(e.tfinger.touchId);
-            if (numFingers == 1 && mouseDown) {
-    float x = e.tfinger.x * 640;
-    float y = e.tfinger.y * 480;
+    // 5. Opcjonalny pre-pass: wypełnienie bufora głębokości bez cieniowania
+    //    (półprzezroczyste nie zapisują głębokości, więc ich tu nie ma)
+    if (depthPrepassEnabled) {
+        frame.setDepth(GL_LESS, true, false);
+        // Warstwy maskowane potrzebują tekstury także w pre-passie
+        bool masked = harpyModel.textureArrayMasked;
+        frame.draw(queues.layered, masked ? arrayDepthProgramMasked : arrayDepthProgram, masked);
+        frame.draw(queues.opaque, depthProgram, false);
+        frame.draw(queues.masked, depthProgramMasked, true);
 
-    float xOffset = x - lastX;
-    float yOffset = y - lastY;
+        // Przebieg główny cieniuje tylko widoczny fragment każdego piksela
+        frame.setDepth(GL_EQUAL, false, true);
+    }
 
-    // 👇 Jeśli palec jest po lewej stronie ekranu (np. przy przycisku głośności)
-    if (x < 150) {
-        modelRotationX += yOffset * rotationSpeed;
+    // 6. Przebieg główny (albo zliczanie fragmentów w widoku overdraw)
+    if (overdrawView) {
+        frame.setBlend(GL_ONE, GL_ONE);
+        frame.draw(queues.layered, overdrawProgram, false);
+        frame.draw(queues.opaque, overdrawProgram, false);
+        frame.draw(queues.masked, overdrawProgram, false);
+        frame.setDepth(GL_LEQUAL, false, true);
+        frame.draw(queues.blended, overdrawProgram, false);
+        frame.setBlend(0, 0);
     } else {
-        // W przeciwnym razie obracamy kamerą
-        cameraYaw += xOffset * rotationSpeed;
-        cameraPitch -= yOffset * rotationSpeed;
-        cameraPitch = glm::clamp(cameraPitch, glm::radians(-89.0f), glm::radians(89.0f));
+        frame.draw(queues.layered, harpyModel.textureArrayMasked ? arrayProgramMasked : arrayProgram, true);
+        frame.draw(queues.opaque, 0, true);
+        frame.draw(queues.masked, 0, true);
+
+        // 7. Półprzezroczyste na końcu, od tyłu, bez zapisu głębokości
+        frame.setDepth(GL_LEQUAL, false, true);
+        frame.setBlend(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        frame.draw(queues.blended, 0, true);
+        frame.setBlend(0, 0);
     }
 
-    lastX = x;
-    lastY = y;
+    renderThread.submit();
+}
+// --- Wejście: wszystkie zdarzenia klatki składane w jedną deltę ---
+// Zdarzenia ruchu tylko sumują przesunięcia; kamera zmienia się raz na krok symulacji,
+// niezależnie od tego, ile zdarzeń przyszło od ostatniej klatki.
+struct FrameInput {
+    float lookX = 0.0f, lookY = 0.0f;  // przeciąganie kamery, piksele
+    float modelDrag = 0.0f;            // przeciąganie modelu (oś Y), piksele
+    float zoom = 0.0f;                 // zmiana odległości kamery
+    float dpadX = 0.0f, dpadY = 0.0f;  // strzałki/WASD trzymane w tej klatce, -1..1
+    bool tapped = false;
+    float tapX = 0.0f, tapY = 0.0f;
+    bool togglePrepass = false;
+    bool toggleOverdraw = false;
+    bool dumpMemory = false;
+    bool resized = false;   // zmiana rozmiaru albo odsłonięcie okna - trzeba odrysować
+    bool quit = false;
 
-            
-            } else if (numFingers == 2) {
-                SDL_Finger* finger1 = SDL_GetTouchFinger(e.tfinger.touchId, 0);
-                SDL_Finger* finger2 = SDL_GetTouchFinger(e.tfinger.touchId, 1);
-                
-                if (finger1 && finger2 && initialFingerDistance > 0.001f) {
-                    float dx = (finger1->x - finger2->x) * 640;
-                    float dy = (finger1->y - finger2->y) * 480;
-                    float currentFingerDistance = sqrt(dx*dx + dy*dy);
-                    
-                    float zoomDelta = initialFingerDistance - currentFingerDistance;
-                    cameraDistance += zoomDelta * zoomSpeed;
-                    
-                    initialFingerDistance = currentFingerDistance;
-                    cameraDistance = glm::clamp(cameraDistance, 1.0f, 15.0f);
-                }
-            }
-        }
+    bool changesView() const {
+        return lookX != 0.0f || lookY != 0.0f || modelDrag != 0.0f || zoom != 0.0f || dpadX != 0.0f ||
+               dpadY != 0.0f || tapped || togglePrepass || toggleOverdraw || resized;
     }
-    render();
-}
-void main_loop2() {
+};
+
+void gatherInput(FrameInput& input) {
     SDL_Event e;
     while (SDL_PollEvent(&e)) {
-        if (e.type == SDL_QUIT) {
-            emscripten_cancel_main_loop();
-        } 
-        
-        // --- Sterowanie myszą ---
-        else if (e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_LEFT) {
-            mouseDown = true;
-            lastX = e.button.x;
-            lastY = e.button.y;
-        } else if (e.type == SDL_MOUSEBUTTONUP && e.button.button == SDL_BUTTON_LEFT) {
-            mouseDown = false;
-        } else if (e.type == SDL_MOUSEMOTION && mouseDown) {
-            cameraYaw += (e.motion.x - lastX) * rotationSpeed;
-            cameraPitch += (e.motion.y - lastY) * rotationSpeed;
-            cameraPitch = glm::clamp(cameraPitch, glm::radians(-89.0f), glm::radians(89.0f));
-
-            lastX = e.motion.x;
-            lastY = e.motion.y;
-        }
-        else if (e.type == SDL_MOUSEWHEEL) {
-            if (e.wheel.y > 0) {
-                cameraDistance -= 0.5f;
-            } else if (e.wheel.y < 0) {
-                cameraDistance += 0.5f;
+        switch (e.type) {
+        case SDL_QUIT:
+            input.quit = true;
+            break;
+        case SDL_WINDOWEVENT:
+            if (e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED || e.window.event == SDL_WINDOWEVENT_EXPOSED) {
+                input.resized = true;
             }
-            cameraDistance = glm::clamp(cameraDistance, 1.0f, 15.0f); 
-        }
+            break;
+
+        // --- Przełączniki trybów renderowania ---
+        case SDL_KEYDOWN:
+            if (e.key.keysym.sym == SDLK_p) input.togglePrepass = !input.togglePrepass;
+            if (e.key.keysym.sym == SDLK_o) input.toggleOverdraw = !input.toggleOverdraw;
+            if (e.key.keysym.sym == SDLK_m) input.dumpMemory = true;
+            break;
+
+        // --- Mysz ---
+        case SDL_MOUSEBUTTONDOWN:
+            if (e.button.button != SDL_BUTTON_LEFT) break;
+            gesture.pointerDown = true;
+            gesture.lastX = gesture.pressX = (float)e.button.x;
+            gesture.lastY = gesture.pressY = (float)e.button.y;
+            break;
+        case SDL_MOUSEBUTTONUP:
+            if (e.button.button != SDL_BUTTON_LEFT) break;
+            gesture.pointerDown = false;
+            if (isTap((float)e.button.x, (float)e.button.y)) {
+                input.tapped = true;
+                input.tapX = (float)e.button.x;
+                input.tapY = (float)e.button.y;
+            }
+            break;
+        case SDL_MOUSEMOTION:
+            if (!gesture.pointerDown) break;
+            input.lookX += e.motion.x - gesture.lastX;
+            input.lookY += e.motion.y - gesture.lastY;
+            gesture.lastX = (float)e.motion.x;
+            gesture.lastY = (float)e.motion.y;
+            break;
+        case SDL_MOUSEWHEEL:
+            if (e.wheel.y > 0) input.zoom -= 0.5f;
+            if (e.wheel.y < 0) input.zoom += 0.5f;
+            break;
 
-        // --- Sterowanie dotykiem ---
-        else if (e.type == SDL_FINGERDOWN) {
+        // --- Dotyk ---
+        case SDL_FINGERDOWN: {
             int numFingers = SDL_GetNumTouchFingers(e.tfinger.touchId);
-            if (numFingers == 1) { 
-                mouseDown = true;
-                lastX = e.tfinger.x * 640;
-                lastY = e.tfinger.y * 480;
-            } else if (numFingers == 2) { 
+            if (numFingers == 1) {
+                gesture.pointerDown = true;
+                gesture.lastX = gesture.pressX = e.tfinger.x * windowWidth;
+                gesture.lastY = gesture.pressY = e.tfinger.y * windowHeight;
+                // Palec na modelu obraca model, poza nim - kamerę
+                PickHit hit;
+                gesture.dragRotatesModel = pickAt(gesture.pressX, gesture.pressY, hit);
+            } else if (numFingers == 2) {
                 SDL_Finger* finger1 = SDL_GetTouchFinger(e.tfinger.touchId, 0);
                 SDL_Finger* finger2 = SDL_GetTouchFinger(e.tfinger.touchId, 1);
-                
                 if (finger1 && finger2) {
-                    float dx = (finger1->x - finger2->x) * 640;
-                    float dy = (finger1->y - finger2->y) * 480;
-                    initialFingerDistance = sqrt(dx*dx + dy*dy);
+                    float dx = (finger1->x - finger2->x) * windowWidth;
+                    float dy = (finger1->y - finger2->y) * windowHeight;
+                    gesture.pinchDistance = std::sqrt(dx * dx + dy * dy);
                 }
+            } else if (numFingers == 3) {
+                // Na telefonie nie ma klawiatury - trzy palce przełączają pre-pass
+                input.togglePrepass = !input.togglePrepass;
+            }
+            break;
+        }
+        case SDL_FINGERUP:
+            // Ostatni palec podniesiony blisko miejsca dotknięcia - wybór submesha
+            if (gesture.pointerDown && SDL_GetNumTouchFingers(e.tfinger.touchId) == 0 &&
+                isTap(e.tfinger.x * windowWidth, e.tfinger.y * windowHeight)) {
+                input.tapped = true;
+                input.tapX = e.tfinger.x * windowWidth;
+                input.tapY = e.tfinger.y * windowHeight;
             }
-        } else if (e.type == SDL_FINGERUP) {
-            mouseDown = false;
-        } else if (e.type == SDL_FINGERMOTION) {
+            gesture.pointerDown = false;
+            break;
+        case SDL_FINGERMOTION: {
             int numFingers = SDL_GetNumTouchFingers(e.tfinger.touchId);
-            if (numFingers == 1 && mouseDown) {
-                float xOffset = e.tfinger.x * 640 - lastX;
-                float yOffset = e.tfinger.y * 480 - lastY;
-                
-                cameraYaw += xOffset * rotationSpeed;
-                cameraPitch += yOffset * rotationSpeed;
-
-                cameraPitch = glm::clamp(cameraPitch, glm::radians(-89.0f), glm::radians(89.0f));
-                
-                lastX = e.tfinger.x * 640;
-                lastY = e.tfinger.y * 480;
+            if (numFingers == 1 && gesture.pointerDown) {
+                float x = e.tfinger.x * windowWidth;
+                float y = e.tfinger.y * windowHeight;
+                if (gesture.dragRotatesModel) {
+                    input.modelDrag += y - gesture.lastY;
+                } else {
+                    input.lookX += x - gesture.lastX;
+                    input.lookY += y - gesture.lastY;
+                }
+                gesture.lastX = x;
+                gesture.lastY = y;
             } else if (numFingers == 2) {
                 SDL_Finger* finger1 = SDL_GetTouchFinger(e.tfinger.touchId, 0);
                 SDL_Finger* finger2 = SDL_GetTouchFinger(e.tfinger.touchId, 1);
-                
-                if (finger1 && finger2 && initialFingerDistance > 0.001f) {
-                    float dx = (finger1->x - finger2->x) * 640;
-                    float dy = (finger1->y - finger2->y) * 480;
-                    float currentFingerDistance = sqrt(dx*dx + dy*dy);
-                    
-                    float zoomDelta = initialFingerDistance - currentFingerDistance;
-                    cameraDistance += zoomDelta * zoomSpeed;
-                    
-                    initialFingerDistance = currentFingerDistance;
-                    cameraDistance = glm::clamp(cameraDistance, 1.0f, 15.0f);
+                if (finger1 && finger2 && gesture.pinchDistance > 0.001f) {
+                    float dx = (finger1->x - finger2->x) * windowWidth;
+                    float dy = (finger1->y - finger2->y) * windowHeight;
+                    float currentDistance = std::sqrt(dx * dx + dy * dy);
+                    input.zoom += (gesture.pinchDistance - currentDistance) * zoomSpeed;
+                    gesture.pinchDistance = currentDistance;
                 }
             }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    // Klawiatura odczytywana raz na klatkę, a nie przy każdym zdarzeniu
+    const Uint8* keys = SDL_GetKeyboardState(nullptr);
+    input.dpadX = (float)((keys[SDL_SCANCODE_RIGHT] || keys[SDL_SCANCODE_D]) - (keys[SDL_SCANCODE_LEFT] || keys[SDL_SCANCODE_A]));
+    input.dpadY = (float)((keys[SDL_SCANCODE_UP] || keys[SDL_SCANCODE_W]) - (keys[SDL_SCANCODE_DOWN] || keys[SDL_SCANCODE_S]));
+}
+
+// --- Kamera: stały krok symulacji z interpolacją ---
+// Wejście przesuwa cel (cameraGoal), stan kamery dochodzi do celu w krokach 1/120 s,
+// a render() dostaje stan interpolowany między dwoma ostatnimi krokami. Szybkość ruchu
+// nie zależy więc ani od liczby zdarzeń, ani od częstotliwości klatek.
+struct CameraState {
+    float yaw = 0.0f;
+    float pitch = 0.0f;
+    float distance = 5.0f;
+    float modelRotationX = 0.0f;
+};
+CameraState cameraGoal, cameraCurrent, cameraPrevious;
+const double cameraStep = 1.0 / 120.0;
+const float cameraFollow = 0.25f;   // część odległości do celu pokonywana w jednym kroku
+const float dpadSpeed = 1.5f;       // rad/s dla strzałek/WASD
+double cameraAccumulator = 0.0;
+double lastFrameSeconds = 0.0;
+
+void applyInput(const FrameInput& input) {
+    if (input.quit) platformQuit();
+    if (input.togglePrepass) {
+        depthPrepassEnabled = !depthPrepassEnabled;
+        std::cout << "Depth pre-pass: " << (depthPrepassEnabled ? "ON" : "OFF") << "\n";
+    }
+    if (input.toggleOverdraw) {
+        overdrawView = !overdrawView;
+        std::cout << "Widok overdraw: " << (overdrawView ? "ON" : "OFF") << "\n";
+    }
+
+    // Ujemny znak pitch, aby ruch w dół przesuwał kamerę w dół
+    cameraGoal.yaw += input.lookX * rotationSpeed;
+    cameraGoal.pitch -= input.lookY * rotationSpeed;
+    cameraGoal.pitch = glm::clamp(cameraGoal.pitch, glm::radians(-89.0f), glm::radians(89.0f));
+    cameraGoal.modelRotationX += input.modelDrag * rotationSpeed;
+    cameraGoal.distance = glm::clamp(cameraGoal.distance + input.zoom, 1.0f, 15.0f);
+
+    if (input.dumpMemory) dumpMemory();
+    if (input.resized) updateWindowSize();
+    if (input.tapped) selectAt(input.tapX, input.tapY);
+}
+
+// Zwraca true, gdy interpolowany stan kamery zmienił się od poprzedniej klatki
+bool stepCamera(const FrameInput& input) {
+    double now = platformNow();
+    double frame = (lastFrameSeconds > 0.0) ? std::min(now - lastFrameSeconds, 0.25) : cameraStep;
+    lastFrameSeconds = now;
+
+    cameraAccumulator += frame;
+    while (cameraAccumulator >= cameraStep) {
+        cameraGoal.yaw += input.dpadX * dpadSpeed * (float)cameraStep;
+        cameraGoal.pitch += input.dpadY * dpadSpeed * (float)cameraStep;
+        cameraGoal.pitch = glm::clamp(cameraGoal.pitch, glm::radians(-89.0f), glm::radians(89.0f));
+
+        cameraPrevious = cameraCurrent;
+        cameraCurrent.yaw += (cameraGoal.yaw - cameraCurrent.yaw) * cameraFollow;
+        cameraCurrent.pitch += (cameraGoal.pitch - cameraCurrent.pitch) * cameraFollow;
+        cameraCurrent.distance += (cameraGoal.distance - cameraCurrent.distance) * cameraFollow;
+        cameraCurrent.modelRotationX += (cameraGoal.modelRotationX - cameraCurrent.modelRotationX) * cameraFollow;
+        cameraAccumulator -= cameraStep;
+    }
+
+    // Kamera praktycznie u celu - domykamy, żeby stan przestał się zmieniać i klatki ustały
+    const float settle = 1e-4f;
+    if (std::fabs(cameraGoal.yaw - cameraCurrent.yaw) < settle && std::fabs(cameraGoal.pitch - cameraCurrent.pitch) < settle &&
+        std::fabs(cameraGoal.distance - cameraCurrent.distance) < settle &&
+        std::fabs(cameraGoal.modelRotationX - cameraCurrent.modelRotationX) < settle) {
+        cameraCurrent = cameraGoal;
+        cameraPrevious = cameraGoal;
+    }
+
+    float alpha = (float)(cameraAccumulator / cameraStep);
+    CameraState shown;
+    shown.yaw = glm::mix(cameraPrevious.yaw, cameraCurrent.yaw, alpha);
+    shown.pitch = glm::mix(cameraPrevious.pitch, cameraCurrent.pitch, alpha);
+    shown.distance = glm::mix(cameraPrevious.distance, cameraCurrent.distance, alpha);
+    shown.modelRotationX = glm::mix(cameraPrevious.modelRotationX, cameraCurrent.modelRotationX, alpha);
+
+    bool moved = shown.yaw != cameraYaw || shown.pitch != cameraPitch || shown.distance != cameraDistance ||
+                 shown.modelRotationX != modelRotationX;
+    cameraYaw = shown.yaw;
+    cameraPitch = shown.pitch;
+    cameraDistance = shown.distance;
+    modelRotationX = shown.modelRotationX;
+    return moved;
+}
+
+bool modelLoaded = false;
+bool modelTexturesRequested = false;
+Assimp::Importer modelImporter;  // FBX czytany raz: wybór tekstur do pobrania, potem Model::load
+
+void loadModel() {
+    std::cout << "Ladowanie modelu..." << std::endl;
+    harpyModel.load(modelImporter, "asserts/el.fbx", "asserts");
+    releaseStagingPool();
+#ifdef PICK_BENCH
+    benchmarkPick(harpyModel);
+#endif
+    std::cout << "Model zaladowany. Liczba meshy: " << harpyModel.meshes.size() << std::endl;
+    dumpMemory();
+    modelLoaded = true;
+    frameScheduler.invalidate();
+}
+
+void main_loop() {
+    // Przed pierwszą klatką czekamy na pliki startowe (natywnie są od razu): najpierw model,
+    // potem tekstury jego materiałów
+    if (!modelLoaded) {
+        if (!assetStore.ready()) return;
+        if (!modelTexturesRequested) {
+            modelTexturesRequested = true;
+            assetStore.fetch(modelTextureAssets(modelImporter.ReadFile("asserts/el.fbx", 0), "asserts"));
+            if (!assetStore.ready()) return;
+        }
+        loadModel();
+    }
+
+    FrameInput input;
+    gatherInput(input);
+    applyInput(input);
+    if (input.changesView()) frameScheduler.invalidate();
+    if (stepCamera(input)) frameScheduler.invalidate();
+    // Dalsze poziomy tekstur mogą czekać na limit uploadów - następna klatka też jest potrzebna
+    if (renderThread.takeStreamingRequest()) frameScheduler.invalidate();
+
+    // Nic się nie zmieniło - bez render() i bez zamiany buforów, płótno zostaje jak było
+    double now = platformNow();
+    if (frameScheduler.dirty) {
+        frameScheduler.dirty = false;
+        render();
+        ++frameScheduler.rendered;
+    } else {
+        ++frameScheduler.skipped;
+    }
+    // Czasy pracy klatek z wątku GL (wyniki zapytań GPU przychodzą z opóźnieniem)
+    dynamicResolution.update();
+
+    if (now - frameScheduler.lastReport >= 10.0) {
+        if (frameScheduler.lastReport > 0.0) {
+            std::cout << "Klatki (10 s): " << frameScheduler.rendered << " narysowanych, " << frameScheduler.skipped
+                      << " pominietych\n";
         }
+        frameScheduler.rendered = 0;
+        frameScheduler.skipped = 0;
+        frameScheduler.lastReport = now;
     }
-    render();
 }
 
 int main() {
@@ -618,11 +4804,11 @@ int main() {
         std::cerr << "Inicjalizacja nie powiodla sie.\n";
         return 1;
     }
-    std::cout << "Ladowanie modelu..." << std::endl;
-    harpyModel.load("asserts/el.fbx", "asserts"); 
-    std::cout << "Model zaladowany. Liczba meshy: " << harpyModel.meshes.size() << std::endl;
-    
-    emscripten_set_main_loop(main_loop, 0, 1);
+    // Paczka startowa ma tylko manifest - model pobieramy teraz, tekstury po nim (main_loop)
+    assetStore.loadManifest("asserts/manifest.txt");
+    assetStore.fetch(startupAssets("asserts/el.fbx", "asserts"));
+
+    platformRun(main_loop);
     
     cleanup();
 
@@ -1,6 +1,7 @@
 #include <SDL.h>
 #include <GLES2/gl2.h>
-#include <emscripten.h>
+#include "platform.h"
+#include "interleave.h"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -73,6 +74,17 @@ GLuint compileShader(GLenum type, const char* source) {
     return shader;
 }
 
+// Przeplot do układu Vertex [x y z u v nx ny nz] z przeskalowaniem pozycji (interleave.h).
+// Brak normalnych daje (0, 1, 0).
+void interleaveVertices(const aiMesh* m, float scale, Vertex* out) {
+    static_assert(sizeof(Vertex) == 8 * sizeof(float), "Vertex to 8 floatów bez wypełnienia");
+    InterleaveOptions options;
+    options.layout = VertexLayout::PositionUVNormal;
+    options.scale = scale;
+    options.missingNormal[1] = 1.0f;
+    interleaveAttributes(m, &out[0].x, options);
+}
+
 Mesh loadMeshFromAssimp(const std::string& path, std::unordered_map<std::string, Material>& materialsOut, const std::string& basePath) {
     Mesh mesh;
     Assimp::Importer importer;
@@ -91,48 +103,36 @@ Mesh loadMeshFromAssimp(const std::string& path, std::unordered_map<std::string,
     const float scale = 0.5f;
     unsigned int vertexOffset = 0;
 
+    // Rozmiary znane z góry - jedna alokacja na bufor zamiast wzrostu przez push_back
+    size_t vertexCount = 0, triangleCount = 0;
     for (unsigned int mIndex = 0; mIndex < scene->mNumMeshes; ++mIndex) {
         const aiMesh* m = scene->mMeshes[mIndex];
-        int materialIndex = m->mMaterialIndex;
-
-        for (unsigned int i = 0; i < m->mNumVertices; ++i) {
-            Vertex v;
-
-            aiVector3D pos = m->mVertices[i];
-            v.x = pos.x * scale;
-            v.y = pos.y * scale;
-            v.z = pos.z * scale;
-
-            if (m->HasTextureCoords(0)) {
-                v.u = m->mTextureCoords[0][i].x;
-                v.v = m->mTextureCoords[0][i].y;
-            } else {
-                v.u = v.v = 0.0f;
-            }
+        vertexCount += m->mNumVertices;
+        for (unsigned int f = 0; f < m->mNumFaces; ++f) {
+            if (m->mFaces[f].mNumIndices == 3) ++triangleCount;
+        }
+    }
+    mesh.vertices.resize(vertexCount);
+    mesh.indices.resize(triangleCount * 3);
+    mesh.materialIndices.resize(triangleCount);
+    mesh.materials.reserve(scene->mNumMaterials);
+    size_t triangle = 0;
 
-            if (m->HasNormals()) {
-                aiVector3D norm = m->mNormals[i];
-                v.nx = norm.x;
-                v.ny = norm.y;
-                v.nz = norm.z;
-            } else {
-                v.nx = 0;
-                v.ny = 1;
-                v.nz = 0;
-            }
+    for (unsigned int mIndex = 0; mIndex < scene->mNumMeshes; ++mIndex) {
+        const aiMesh* m = scene->mMeshes[mIndex];
+        int materialIndex = m->mMaterialIndex;
 
-            mesh.vertices.push_back(v);
-        }
+        interleaveVertices(m, scale, mesh.vertices.data() + vertexOffset);
 
         for (unsigned int f = 0; f < m->mNumFaces; ++f) {
             const aiFace& face = m->mFaces[f];
             if (face.mNumIndices != 3) continue;
 
             for (unsigned int j = 0; j < 3; ++j) {
-                mesh.indices.push_back(vertexOffset + face.mIndices[j]);
+                mesh.indices[triangle * 3 + j] = vertexOffset + face.mIndices[j];
             }
 
-            mesh.materialIndices.push_back(materialIndex);
+            mesh.materialIndices[triangle++] = materialIndex;
         }
 
         vertexOffset += m->mNumVertices;
@@ -256,7 +256,7 @@ void render() {
 void loop() {
     SDL_Event e;
     while (SDL_PollEvent(&e)) {
-        if (e.type == SDL_QUIT) emscripten_cancel_main_loop();
+        if (e.type == SDL_QUIT) platformQuit();
         else if (e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_LEFT) {
             mouseDown = true;
             lastX = e.button.x;
@@ -278,6 +278,6 @@ int main() {
         printf("Initialization failed!\n");
         return 1;
     }
-    emscripten_set_main_loop(loop, 0, 1);
+    platformRun(loop);
     return 0;
 }
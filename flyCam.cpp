@@ -1,7 +1,7 @@
 #include <SDL.h>
 #include <SDL_image.h>
 #include <GLES2/gl2.h>
-#include <emscripten.h>
+#include "platform.h"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -9,6 +9,7 @@
 #include <vector>
 #include <string>
 #include <cmath>
+#include <algorithm>
 #include <iostream>
 
 #include <glm/glm.hpp>
@@ -29,7 +30,8 @@ float yaw = -90.0f; // obrót na boki
 float pitch = 0.0f;  // obrót w górę/dół
 float lastX, lastY;
 bool mouseDown = false;
-float cameraSpeed = 0.05f;
+float cameraSpeed = 3.0f;   // jednostki na sekundę (wcześniej 0.05 na zdarzenie)
+Uint32 lastFrameTicks = 0;
 
 // Lokalizacje uniformów w shaderze
 GLint uniformMVPLoc;
@@ -431,7 +433,7 @@ void main_loop() {
     SDL_Event e;
     while (SDL_PollEvent(&e)) {
         if (e.type == SDL_QUIT) {
-            emscripten_cancel_main_loop();
+            platformQuit();
         } 
         
         // --- OBSŁUGA MYSZY ---
@@ -457,18 +459,25 @@ void main_loop() {
             if(pitch > 89.0f) pitch = 89.0f;
             if(pitch < -89.0f) pitch = -89.0f;
         }
-        
-        // --- Obsługa klawiatury do poruszania kamerą (WASD)
-        const Uint8 *state = SDL_GetKeyboardState(NULL);
-        if (state[SDL_SCANCODE_W])
-            cameraPos += cameraSpeed * cameraFront;
-        if (state[SDL_SCANCODE_S])
-            cameraPos -= cameraSpeed * cameraFront;
-        if (state[SDL_SCANCODE_A])
-            cameraPos -= glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
-        if (state[SDL_SCANCODE_D])
-            cameraPos += glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
     }
+
+    // --- Obsługa klawiatury do poruszania kamerą (WASD)
+    // Raz na klatkę, po zdarzeniach; prędkość w jednostkach na sekundę, więc ruch
+    // nie zależy od liczby zdarzeń ani od częstotliwości klatek
+    Uint32 now = SDL_GetTicks();
+    float dt = lastFrameTicks ? std::min((now - lastFrameTicks) / 1000.0f, 0.25f) : 0.0f;
+    lastFrameTicks = now;
+    float step = cameraSpeed * dt;
+
+    const Uint8 *state = SDL_GetKeyboardState(NULL);
+    if (state[SDL_SCANCODE_W])
+        cameraPos += step * cameraFront;
+    if (state[SDL_SCANCODE_S])
+        cameraPos -= step * cameraFront;
+    if (state[SDL_SCANCODE_A])
+        cameraPos -= glm::normalize(glm::cross(cameraFront, cameraUp)) * step;
+    if (state[SDL_SCANCODE_D])
+        cameraPos += glm::normalize(glm::cross(cameraFront, cameraUp)) * step;
     render();
 }
 
@@ -481,7 +490,7 @@ int main() {
     harpyModel.load("asserts/el.fbx", "asserts"); 
     std::cout << "Model zaladowany. Liczba meshy: " << harpyModel.meshes.size() << std::endl;
     
-    emscripten_set_main_loop(main_loop, 0, 1);
+    platformRun(main_loop);
     
     cleanup();
 
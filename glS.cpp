@@ -1,6 +1,6 @@
 #include <SDL.h>
 #include <GLES2/gl2.h>
-#include <emscripten.h>
+#include "platform.h"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -305,7 +305,7 @@ void render() {
 void loop(){
     SDL_Event e;
     while(SDL_PollEvent(&e)){
-        if (e.type == SDL_QUIT) emscripten_cancel_main_loop();
+        if (e.type == SDL_QUIT) platformQuit();
         else if(e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_LEFT){
             mouseDown = true; lastX = e.button.x; lastY = e.button.y;
         } else if(e.type == SDL_MOUSEBUTTONUP && e.button.button == SDL_BUTTON_LEFT){
@@ -324,6 +324,6 @@ int main() {
         printf("Initialization failed.\n");
         return 1;
     }
-    emscripten_set_main_loop(loop, 0, 1);
+    platformRun(loop);
     return 0;
 }
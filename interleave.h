@@ -0,0 +1,147 @@
+// interleave.h - przeplot atrybutów wierzchołków z tablic Assimpa, wspólny dla cc.cpp,
+// sceny2.cpp i finał.cpp.
+//
+// Assimp trzyma pozycje, normalne i UV w osobnych tablicach aiVector3D (po 3 floaty), GPU
+// dostaje 8 floatów na wierzchołek. Wariant szablonu (układ, normalne, UV) wybierany jest raz
+// na mesh, więc w pętli nie ma rozgałęzień na HasNormals()/HasTextureCoords(). Wersja SIMD
+// (SSE2 natywnie, simd128 w wasm) czyta po 16 bajtów z każdej tablicy - ostatni wierzchołek
+// przechodzi ścieżką skalarną, żeby nie czytać za końcem tablicy.
+//
+// Użycie:
+//     InterleaveOptions options;                  // [px py pz nx ny nz u v], skala 1
+//     InterleaveBounds bounds;                    // opcjonalnie: pudełko pozycji po skalowaniu
+//     interleaveAttributes(mesh, out, options, &bounds);
+#pragma once
+
+#include <assimp/scene.h>
+#include <cstddef>
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+enum class VertexLayout {
+    PositionNormalUV,  // [px py pz nx ny nz u v]
+    PositionUVNormal   // [px py pz u v nx ny nz]
+};
+
+struct InterleaveOptions {
+    VertexLayout layout = VertexLayout::PositionNormalUV;
+    float scale = 1.0f;                              // mnożnik pozycji
+    float missingNormal[3] = {0.0f, 0.0f, 0.0f};     // gdy mesh nie ma normalnych
+};
+
+struct InterleaveBounds {
+    float min[3] = {1e30f, 1e30f, 1e30f};
+    float max[3] = {-1e30f, -1e30f, -1e30f};
+};
+
+template <VertexLayout layout, bool hasNormals, bool hasUV>
+void interleaveKernel(const aiMesh* mesh, float* out, const InterleaveOptions& options, InterleaveBounds* bounds) {
+    const float* pos = &mesh->mVertices[0].x;
+    const float* nrm = hasNormals ? &mesh->mNormals[0].x : nullptr;
+    const float* uv = hasUV ? &mesh->mTextureCoords[0][0].x : nullptr;
+    const float* missing = options.missingNormal;
+    float scale = options.scale;
+    size_t count = mesh->mNumVertices;
+    size_t j = 0;
+    float lo[4] = {1e30f, 1e30f, 1e30f, 1e30f};
+    float hi[4] = {-1e30f, -1e30f, -1e30f, -1e30f};
+
+#if defined(__wasm_simd128__)
+    v128_t vscale = wasm_f32x4_splat(scale);
+    v128_t noNormal = wasm_f32x4_make(missing[0], missing[1], missing[2], 0.0f);
+    v128_t zero = wasm_f32x4_splat(0.0f);
+    v128_t vmin = wasm_v128_load(lo);
+    v128_t vmax = wasm_v128_load(hi);
+    for (; j + 1 < count; ++j) {
+        v128_t a = wasm_f32x4_mul(wasm_v128_load(pos + j * 3), vscale);
+        v128_t b = hasNormals ? wasm_v128_load(nrm + j * 3) : noNormal;
+        v128_t c = hasUV ? wasm_v128_load(uv + j * 3) : zero;
+        if (layout == VertexLayout::PositionNormalUV) {
+            wasm_v128_store(out + j * 8, wasm_i32x4_shuffle(a, b, 0, 1, 2, 4));
+            wasm_v128_store(out + j * 8 + 4, wasm_i32x4_shuffle(b, c, 1, 2, 4, 5));
+        } else {
+            wasm_v128_store(out + j * 8, wasm_i32x4_shuffle(a, c, 0, 1, 2, 4));
+            wasm_v128_store(out + j * 8 + 4, wasm_i32x4_shuffle(c, b, 1, 4, 5, 6));
+        }
+        vmin = wasm_f32x4_min(vmin, a);
+        vmax = wasm_f32x4_max(vmax, a);
+    }
+    wasm_v128_store(lo, vmin);
+    wasm_v128_store(hi, vmax);
+#elif defined(__SSE2__) || defined(_M_X64)
+    __m128 vscale = _mm_set1_ps(scale);
+    __m128 noNormal = _mm_setr_ps(missing[0], missing[1], missing[2], 0.0f);
+    __m128 zero = _mm_setzero_ps();
+    __m128 vmin = _mm_loadu_ps(lo);
+    __m128 vmax = _mm_loadu_ps(hi);
+    for (; j + 1 < count; ++j) {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(pos + j * 3), vscale);
+        __m128 b = hasNormals ? _mm_loadu_ps(nrm + j * 3) : noNormal;
+        __m128 c = hasUV ? _mm_loadu_ps(uv + j * 3) : zero;
+        if (layout == VertexLayout::PositionNormalUV) {
+            __m128 zx = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 2, 2));                     // pz pz nx nx
+            _mm_storeu_ps(out + j * 8, _mm_shuffle_ps(a, zx, _MM_SHUFFLE(2, 0, 1, 0)));     // px py pz nx
+            _mm_storeu_ps(out + j * 8 + 4, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 0, 2, 1)));  // ny nz u v
+        } else {
+            __m128 zu = _mm_shuffle_ps(a, c, _MM_SHUFFLE(0, 0, 2, 2));                     // pz pz u u
+            _mm_storeu_ps(out + j * 8, _mm_shuffle_ps(a, zu, _MM_SHUFFLE(2, 0, 1, 0)));     // px py pz u
+            __m128 vn = _mm_shuffle_ps(c, b, _MM_SHUFFLE(0, 0, 1, 1));                     // v v nx nx
+            _mm_storeu_ps(out + j * 8 + 4, _mm_shuffle_ps(vn, b, _MM_SHUFFLE(2, 1, 2, 0)));  // v nx ny nz
+        }
+        vmin = _mm_min_ps(vmin, a);
+        vmax = _mm_max_ps(vmax, a);
+    }
+    _mm_storeu_ps(lo, vmin);
+    _mm_storeu_ps(hi, vmax);
+#endif
+
+    for (; j < count; ++j) {
+        float* v = out + j * 8;
+        float* n = (layout == VertexLayout::PositionNormalUV) ? v + 3 : v + 5;
+        float* t = (layout == VertexLayout::PositionNormalUV) ? v + 6 : v + 3;
+        for (int k = 0; k < 3; ++k) {
+            v[k] = pos[j * 3 + k] * scale;
+            lo[k] = v[k] < lo[k] ? v[k] : lo[k];
+            hi[k] = v[k] > hi[k] ? v[k] : hi[k];
+        }
+        for (int k = 0; k < 3; ++k) n[k] = hasNormals ? nrm[j * 3 + k] : missing[k];
+        t[0] = hasUV ? uv[j * 3] : 0.0f;
+        t[1] = hasUV ? uv[j * 3 + 1] : 0.0f;
+    }
+
+    if (bounds) {
+        for (int k = 0; k < 3; ++k) {
+            bounds->min[k] = lo[k] < bounds->min[k] ? lo[k] : bounds->min[k];
+            bounds->max[k] = hi[k] > bounds->max[k] ? hi[k] : bounds->max[k];
+        }
+    }
+}
+
+template <VertexLayout layout>
+void interleaveWithLayout(const aiMesh* mesh, float* out, const InterleaveOptions& options, InterleaveBounds* bounds) {
+    bool normals = mesh->HasNormals();
+    bool uvs = mesh->HasTextureCoords(0);
+    if (normals && uvs) {
+        interleaveKernel<layout, true, true>(mesh, out, options, bounds);
+    } else if (normals) {
+        interleaveKernel<layout, true, false>(mesh, out, options, bounds);
+    } else if (uvs) {
+        interleaveKernel<layout, false, true>(mesh, out, options, bounds);
+    } else {
+        interleaveKernel<layout, false, false>(mesh, out, options, bounds);
+    }
+}
+
+// out musi mieć miejsce na 8 * mNumVertices floatów
+inline void interleaveAttributes(const aiMesh* mesh, float* out, const InterleaveOptions& options = InterleaveOptions(),
+                                 InterleaveBounds* bounds = nullptr) {
+    if (options.layout == VertexLayout::PositionNormalUV) {
+        interleaveWithLayout<VertexLayout::PositionNormalUV>(mesh, out, options, bounds);
+    } else {
+        interleaveWithLayout<VertexLayout::PositionUVNormal>(mesh, out, options, bounds);
+    }
+}
@@ -0,0 +1,247 @@
+// jobs.h - system zadań: pula wątków z dequami Chase-Leva, wspólna dla cc.cpp i testu
+// jobs_test.cpp (uruchamianego w CI pod ThreadSanitizerem).
+//
+// Stała pula wątków, każdy z własnym dequem Chase-Leva bez blokad: właściciel wkłada
+// i zdejmuje zadania z dołu, pozostali kradną z góry. Kolejne zadania wkładane przez
+// jeden wątek kradzione są więc w kolejności wkładania - przy liście posortowanej
+// malejąco duże zadania od razu trafiają do pomocników. Na zakończenie zadań czeka się
+// przez JobCounter, a wait() zamiast spać wykonuje zadania z kolejek. Bez wątków
+// (Emscripten bez -pthread) pula ma zero pracowników i wszystko wykonuje wątek czekający.
+//
+// Użycie:
+//     std::vector<size_t> order = ...;            // najdłuższe zadania najpierw
+//     jobSystem().run(order, [&](size_t i) { ... });
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct JobCounter {
+    std::atomic<size_t> pending{0};
+    bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+};
+
+// Zadanie nie jest kopiowane - musi żyć, dopóki jego licznik nie spadnie do zera
+struct Job {
+    const std::function<void(size_t)>* task = nullptr;
+    size_t index = 0;
+    JobCounter* counter = nullptr;
+};
+
+class WorkStealingDeque {
+public:
+    WorkStealingDeque() {
+        for (auto& slot : slots) slot.store(nullptr, std::memory_order_relaxed);
+    }
+
+    bool push(Job* job);  // tylko właściciel; false, gdy deque jest pełny
+    Job* pop();           // tylko właściciel
+    Job* steal();         // dowolny wątek
+
+private:
+    static const int64_t capacity = 4096;  // potęga dwójki
+
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    alignas(64) std::atomic<Job*> slots[capacity];
+};
+
+inline bool WorkStealingDeque::push(Job* job) {
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    if (b - t >= capacity) return false;
+    slots[b & (capacity - 1)].store(job, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_release);  // publikuje zadanie złodziejom
+    return true;
+}
+
+inline Job* WorkStealingDeque::pop() {
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    // Zapis bottom i odczyt top w porządku seq_cst zamiast relaxed + atomic_thread_fence:
+    // ta sama gwarancja, a ThreadSanitizer (nie modeluje samodzielnych barier) ją widzi
+    bottom.store(b, std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_seq_cst);
+    if (t > b) {
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    Job* job = slots[b & (capacity - 1)].load(std::memory_order_relaxed);
+    if (t == b) {
+        // Ostatnie zadanie - wyścig ze złodziejem rozstrzyga CAS na top
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            job = nullptr;
+        }
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+inline Job* WorkStealingDeque::steal() {
+    int64_t t = top.load(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_seq_cst);
+    if (t >= b) return nullptr;
+    Job* job = slots[t & (capacity - 1)].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;  // ktoś był szybszy
+    }
+    return job;
+}
+
+class JobSystem {
+public:
+    explicit JobSystem(unsigned workerCount);
+    ~JobSystem();
+
+    // Z wątku spoza puli (innego niż tworzący) zadanie wykonuje się od razu
+    void submit(Job& job);
+    // Wykonuje cudze zadania, dopóki licznik nie spadnie do zera
+    void wait(const JobCounter& counter);
+    // Wykonuje task(i) dla każdego i z order i czeka na zakończenie wszystkich
+    void run(const std::vector<size_t>& order, const std::function<void(size_t)>& task);
+    unsigned threadCount() const { return (unsigned)deques.size(); }
+
+private:
+    std::vector<std::unique_ptr<WorkStealingDeque>> deques;  // [0] należy do wątku tworzącego
+    std::vector<std::thread> workers;
+    std::thread::id owner;
+
+    std::atomic<size_t> queued{0};      // włożone, jeszcze niepodjęte
+    std::atomic<unsigned> sleepers{0};
+    std::atomic<bool> stopping{false};
+    std::mutex sleepLock;
+    std::condition_variable wake;
+
+    int selfIndex() const;
+    Job* findJob(unsigned self);
+    void execute(Job* job);
+    void workerLoop(unsigned self);
+};
+
+inline thread_local const JobSystem* currentJobSystem = nullptr;
+inline thread_local unsigned currentJobWorker = 0;
+
+inline JobSystem::JobSystem(unsigned workerCount) : owner(std::this_thread::get_id()) {
+    for (unsigned i = 0; i <= workerCount; ++i) {
+        deques.push_back(std::unique_ptr<WorkStealingDeque>(new WorkStealingDeque()));
+    }
+    for (unsigned i = 1; i <= workerCount; ++i) {
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+inline JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : workers) t.join();
+}
+
+inline int JobSystem::selfIndex() const {
+    if (currentJobSystem == this) return (int)currentJobWorker;
+    if (std::this_thread::get_id() == owner) return 0;
+    return -1;
+}
+
+inline Job* JobSystem::findJob(unsigned self) {
+    Job* job = deques[self]->pop();
+    for (size_t k = 1; !job && k < deques.size(); ++k) {
+        job = deques[(self + k) % deques.size()]->steal();
+    }
+    if (job) queued.fetch_sub(1);
+    return job;
+}
+
+inline void JobSystem::execute(Job* job) {
+    (*job->task)(job->index);
+    if (job->counter) job->counter->pending.fetch_sub(1, std::memory_order_release);
+}
+
+inline void JobSystem::submit(Job& job) {
+    if (job.counter) job.counter->pending.fetch_add(1, std::memory_order_relaxed);
+    int self = selfIndex();
+    if (self < 0 || workers.empty() || !deques[self]->push(&job)) {
+        execute(&job);
+        return;
+    }
+    queued.fetch_add(1);
+    // Budzenie tylko, gdy ktoś śpi - przy zajętej puli submit to kilka operacji atomowych
+    if (sleepers.load() > 0) {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        wake.notify_one();
+    }
+}
+
+inline void JobSystem::wait(const JobCounter& counter) {
+    int self = selfIndex();
+    while (!counter.done()) {
+        Job* job = self >= 0 ? findJob((unsigned)self) : nullptr;
+        if (job) {
+            execute(job);
+        } else {
+            // Ostatnie zadania wykonują się u innych - nie ma czego ukraść
+            std::this_thread::yield();
+        }
+    }
+}
+
+inline void JobSystem::workerLoop(unsigned self) {
+    currentJobSystem = this;
+    currentJobWorker = self;
+    int idleRounds = 0;
+    while (!stopping.load(std::memory_order_relaxed)) {
+        Job* job = findJob(self);
+        if (job) {
+            execute(job);
+            idleRounds = 0;
+            continue;
+        }
+        // Krótko kręcimy się przed zaśnięciem - kolejne zadania klatki przychodzą zwykle zaraz
+        if (++idleRounds < 64) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(sleepLock);
+        ++sleepers;
+        wake.wait(guard, [&] { return stopping.load() || queued.load() > 0; });
+        --sleepers;
+        idleRounds = 0;
+    }
+}
+
+inline void JobSystem::run(const std::vector<size_t>& order, const std::function<void(size_t)>& task) {
+    std::vector<Job> jobs(order.size());
+    JobCounter counter;
+    for (size_t i = 0; i < order.size(); ++i) {
+        jobs[i].task = &task;
+        jobs[i].index = order[i];
+        jobs[i].counter = &counter;
+        submit(jobs[i]);
+    }
+    wait(counter);
+}
+
+inline unsigned jobWorkerThreads() {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    return 0;
+#else
+    unsigned cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 0;
+#endif
+}
+
+// Pula powstaje przy pierwszym użyciu, a nie w statycznej inicjalizacji: wątki startują
+// dopiero po wejściu do main(), gdy w Emscripten działa już runtime pthreads. Wątek, który
+// pierwszy wywoła jobSystem(), zostaje właścicielem deque 0.
+inline JobSystem& jobSystem() {
+    static JobSystem system(jobWorkerThreads());
+    return system;
+}
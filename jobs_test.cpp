@@ -0,0 +1,119 @@
+// Test systemu zadań z jobs.h - osobny program, bez SDL i Assimpa, uruchamiany w CI.
+// Budowanie natywne:
+//   g++ -O1 -g -std=c++17 -pthread -fsanitize=thread jobs_test.cpp -o jobs_test
+//   ./jobs_test           - test obciążeniowy (pod ThreadSanitizerem wykrywa wyścigi w dequach)
+//   ./jobs_test --bench   - skalowanie puli i koszt pustego zadania (bez -fsanitize)
+// Pula ma zawsze co najmniej 4 pracowników, także na maszynie z jednym rdzeniem - inaczej
+// kradzież zadań nie byłaby w ogóle sprawdzana.
+#include "jobs.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+// --- Test obciążeniowy ---
+// Zadania o różnej liczności (także ponad pojemność deque, wtedy reszta wykonuje się od
+// razu), zagnieżdżone submit/wait z wątków puli i submit z obcego wątku. Każde zadanie
+// musi wykonać się dokładnie raz.
+bool stressJobs(JobSystem& jobs) {
+    for (int round = 0; round < 2000; ++round) {
+        size_t count = 1 + (size_t)(round * 37) % (round % 10 == 0 ? 6000 : 500);
+        std::vector<size_t> order(count);
+        for (size_t i = 0; i < count; ++i) order[i] = i;
+        std::vector<std::atomic<int>> runs(count);
+        std::atomic<size_t> nested{0};
+        std::function<void(size_t)> counted = [&](size_t) { nested.fetch_add(1, std::memory_order_relaxed); };
+
+        jobs.run(order, [&](size_t i) {
+            runs[i].fetch_add(1, std::memory_order_relaxed);
+            Job children[3];
+            JobCounter counter;
+            for (Job& job : children) {
+                job.task = &counted;
+                job.counter = &counter;
+                jobs.submit(job);
+            }
+            jobs.wait(counter);
+        });
+
+        // Obcy wątek: submit wykonuje zadanie od razu, bez deque
+        std::thread outsider([&] {
+            Job job;
+            JobCounter counter;
+            job.task = &counted;
+            job.counter = &counter;
+            jobs.submit(job);
+            jobs.wait(counter);
+        });
+        outsider.join();
+
+        for (size_t i = 0; i < count; ++i) {
+            if (runs[i].load() != 1) {
+                std::cerr << "Zadanie " << i << " wykonane " << runs[i].load() << " razy (runda " << round << ")\n";
+                return false;
+            }
+        }
+        if (nested.load() != count * 3 + 1) {
+            std::cerr << "Zagniezdzone zadania: " << nested.load() << " zamiast " << count * 3 + 1 << "\n";
+            return false;
+        }
+    }
+    std::cout << "Test zadan: OK (" << jobs.threadCount() << " watkow)\n";
+    return true;
+}
+
+// --- Benchmark skalowania ---
+// Zadania o malejącym koszcie (jak BVH submeshy posortowane od największego) liczone
+// przez pule o rosnącej liczbie wątków, plus koszt samego zadania (submit + wykonanie +
+// wait) przy pustej pracy
+double syntheticWork(size_t steps) {
+    double x = 0.0;
+    for (size_t i = 0; i < steps; ++i) x += std::sqrt((double)i + x * 1e-9);
+    return x;
+}
+
+void benchmarkJobs() {
+    const size_t jobCount = 64;
+    std::vector<size_t> order(jobCount);
+    for (size_t i = 0; i < jobCount; ++i) order[i] = i;
+
+    unsigned maxWorkers = std::max(jobWorkerThreads(), 1u);
+    std::vector<unsigned> workerCounts;
+    for (unsigned workers = 0; workers < maxWorkers; workers = workers ? workers * 2 : 1) workerCounts.push_back(workers);
+    workerCounts.push_back(maxWorkers);
+
+    double singleMs = 0.0;
+    for (unsigned workers : workerCounts) {
+        JobSystem pool(workers);
+        std::vector<double> results(jobCount);
+        std::function<void(size_t)> work = [&](size_t i) { results[i] = syntheticWork(200000 * (jobCount - i)); };
+        auto start = std::chrono::steady_clock::now();
+        pool.run(order, work);
+        std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - start;
+        if (workers == 0) singleMs = ms.count();
+        std::cout << "Zadania, " << pool.threadCount() << " watkow: " << ms.count() << " ms (x" << singleMs / ms.count()
+                  << ")\n";
+    }
+
+    const size_t emptyJobs = 100000;
+    std::vector<size_t> indices(emptyJobs);
+    for (size_t i = 0; i < emptyJobs; ++i) indices[i] = i;
+    std::atomic<size_t> sum{0};
+    std::function<void(size_t)> touch = [&](size_t i) { sum.fetch_add(i, std::memory_order_relaxed); };
+    JobSystem& jobs = jobSystem();
+    auto start = std::chrono::steady_clock::now();
+    jobs.run(indices, touch);
+    std::chrono::duration<double, std::nano> ns = std::chrono::steady_clock::now() - start;
+    std::cout << "Puste zadanie (" << jobs.threadCount() << " watkow): " << ns.count() / emptyJobs << " ns\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        benchmarkJobs();
+        return 0;
+    }
+    JobSystem jobs(std::max(jobWorkerThreads(), 4u));
+    return stressJobs(jobs) ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+// platform.h - wspólna pętla klatek dla wszystkich programów.
+//
+// W przeglądarce klatki napędza requestAnimationFrame (emscripten_request_animation_frame_loop),
+// a main() kończy się przez emscripten_exit_with_live_runtime() - tak samo jak przy
+// emscripten_set_main_loop(..., 1), ale bez ASYNCIFY. Na Linuksie to zwykła pętla
+// z vsync albo bez limitu klatek; platformRun() wraca po platformQuit(), więc sprzątanie
+// po nim wykonuje się normalnie.
+//
+// Użycie:
+//     void main_loop() { ... if (e.type == SDL_QUIT) platformQuit(); ... }
+//     int main() { init(); platformRun(main_loop); cleanup(); }
+#pragma once
+
+#include <SDL.h>
+#include <iostream>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#include <emscripten/html5.h>
+#endif
+
+enum class SwapMode {
+    Vsync,      // klatka czeka na odświeżenie ekranu
+    Uncapped    // tylko natywnie: bez limitu, do pomiaru czystego czasu klatki
+};
+
+struct PlatformLoop {
+    void (*frame)() = nullptr;
+    bool running = false;
+    double now = 0.0;       // s, początek bieżącej klatki
+    double delta = 0.0;     // s, odstęp od początku poprzedniej klatki
+    unsigned long frames = 0;
+};
+
+inline PlatformLoop& platformLoop() {
+    static PlatformLoop loop;
+    return loop;
+}
+
+// Czas monotoniczny w sekundach
+inline double platformNow() {
+#ifdef __EMSCRIPTEN__
+    return emscripten_get_now() / 1000.0;
+#else
+    return (double)SDL_GetPerformanceCounter() / (double)SDL_GetPerformanceFrequency();
+#endif
+}
+
+inline double platformFrameDelta() { return platformLoop().delta; }
+
+// Kończy pętlę po bieżącej klatce
+inline void platformQuit() { platformLoop().running = false; }
+
+inline void platformFrame(double now) {
+    PlatformLoop& loop = platformLoop();
+    loop.delta = loop.frames ? now - loop.now : 0.0;
+    loop.now = now;
+    ++loop.frames;
+    loop.frame();
+}
+
+#ifdef __EMSCRIPTEN__
+inline EM_BOOL platformAnimationFrame(double timeMs, void*) {
+    if (!platformLoop().running) return EM_FALSE;
+    platformFrame(timeMs / 1000.0);
+    return platformLoop().running ? EM_TRUE : EM_FALSE;
+}
+#endif
+
+// Uruchamia pętlę; kontekst GL musi już istnieć (natywnie ustawiany jest tu interwał zamiany)
+inline void platformRun(void (*frame)(), SwapMode mode = SwapMode::Vsync) {
+    PlatformLoop& loop = platformLoop();
+    loop.frame = frame;
+    loop.running = true;
+    loop.frames = 0;
+
+#ifdef __EMSCRIPTEN__
+    // requestAnimationFrame i tak jest zsynchronizowany z ekranem
+    (void)mode;
+    emscripten_request_animation_frame_loop(platformAnimationFrame, nullptr);
+    emscripten_exit_with_live_runtime();
+#else
+    if (SDL_GL_SetSwapInterval(mode == SwapMode::Vsync ? 1 : 0) != 0) {
+        std::cerr << "Nie mozna ustawic interwalu zamiany buforow: " << SDL_GetError() << "\n";
+    }
+    while (loop.running) {
+        platformFrame(platformNow());
+    }
+#endif
+}
@@ -1,6 +1,6 @@
 #include <SDL.h>
 #include <GLES2/gl2.h>
-#include <emscripten.h>
+#include "platform.h"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -377,7 +377,7 @@ glUniform1i(glGetUniformLocation(program, "emissiveMap"), 3);
 void loop(){
     SDL_Event e;
     while(SDL_PollEvent(&e)){
-        if (e.type == SDL_QUIT) emscripten_cancel_main_loop();
+        if (e.type == SDL_QUIT) platformQuit();
         else if(e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_LEFT){
             mouseDown = true; lastX = e.button.x; lastY = e.button.y;
         } else if(e.type == SDL_MOUSEBUTTONUP && e.button.button == SDL_BUTTON_LEFT){
@@ -397,7 +397,7 @@ int main() {
         printf("Initialization failed.\n");
         return 1;
     }
-    emscripten_set_main_loop(loop, 0, 1);
+    platformRun(loop);
     
     harpyModel.cleanup();
     SDL_GL_DeleteContext(glContext);
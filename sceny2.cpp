@@ -1,6 +1,7 @@
 #include <SDL.h>
 #include <GLES2/gl2.h>
-#include <emscripten.h>
+#include "platform.h"
+#include "interleave.h"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -155,6 +156,11 @@ Material loadMaterial(const aiScene* scene, const aiMesh* mesh, const std::strin
     return mat;
 }
 
+// --- Przeplot atrybutów: osobne tablice Assimpa -> [pozycja, normalna, UV] (interleave.h) ---
+void interleaveVertices(const aiMesh* mesh, float* out) {
+    interleaveAttributes(mesh, out);
+}
+
 // Funkcja do wczytywania geometrii
 MeshData loadMeshFromAssimp(const char* path) {
     Assimp::Importer importer;
@@ -172,26 +178,7 @@ MeshData loadMeshFromAssimp(const char* path) {
         unsigned int currentVerticesSize = meshData.vertices.size();
         meshData.vertices.resize(currentVerticesSize + mesh->mNumVertices * 8);
 
-        for (unsigned int j = 0; j < mesh->mNumVertices; ++j) {
-            meshData.vertices[currentVerticesSize + j * 8 + 0] = mesh->mVertices[j].x;
-            meshData.vertices[currentVerticesSize + j * 8 + 1] = mesh->mVertices[j].y;
-            meshData.vertices[currentVerticesSize + j * 8 + 2] = mesh->mVertices[j].z;
-            
-            if (mesh->HasNormals()){
-                meshData.vertices[currentVerticesSize + j * 8 + 3] = mesh->mNormals[j].x;
-                meshData.vertices[currentVerticesSize + j * 8 + 4] = mesh->mNormals[j].y;
-                meshData.vertices[currentVerticesSize + j * 8 + 5] = mesh->mNormals[j].z;
-            } else {
-                meshData.vertices[currentVerticesSize + j * 8 + 3] = 0.0f; meshData.vertices[currentVerticesSize + j * 8 + 4] = 0.0f; meshData.vertices[currentVerticesSize + j * 8 + 5] = 0.0f;
-            }
-
-            if (mesh->HasTextureCoords(0)){
-                meshData.vertices[currentVerticesSize + j * 8 + 6] = mesh->mTextureCoords[0][j].x;
-                meshData.vertices[currentVerticesSize + j * 8 + 7] = mesh->mTextureCoords[0][j].y;
-            } else {
-                meshData.vertices[currentVerticesSize + j * 8 + 6] = 0.0f; meshData.vertices[currentVerticesSize + j * 8 + 7] = 0.0f;
-            }
-        }
+        interleaveVertices(mesh, meshData.vertices.data() + currentVerticesSize);
         unsigned int indexOffset = currentVerticesSize / 8;
         for (unsigned int j = 0; j < mesh->mNumFaces; ++j) {
             const aiFace& face = mesh->mFaces[j];
@@ -229,26 +216,7 @@ Model loadModel(const char* meshPath, const std::string& textureDirectory) {
         unsigned int currentVerticesSize = meshData.vertices.size();
         meshData.vertices.resize(currentVerticesSize + mesh->mNumVertices * 8);
 
-        for (unsigned int j = 0; j < mesh->mNumVertices; ++j) {
-            meshData.vertices[currentVerticesSize + j * 8 + 0] = mesh->mVertices[j].x;
-            meshData.vertices[currentVerticesSize + j * 8 + 1] = mesh->mVertices[j].y;
-            meshData.vertices[currentVerticesSize + j * 8 + 2] = mesh->mVertices[j].z;
-            
-            if (mesh->HasNormals()){
-                meshData.vertices[currentVerticesSize + j * 8 + 3] = mesh->mNormals[j].x;
-                meshData.vertices[currentVerticesSize + j * 8 + 4] = mesh->mNormals[j].y;
-                meshData.vertices[currentVerticesSize + j * 8 + 5] = mesh->mNormals[j].z;
-            } else {
-                meshData.vertices[currentVerticesSize + j * 8 + 3] = 0.0f; meshData.vertices[currentVerticesSize + j * 8 + 4] = 0.0f; meshData.vertices[currentVerticesSize + j * 8 + 5] = 0.0f;
-            }
-
-            if (mesh->HasTextureCoords(0)){
-                meshData.vertices[currentVerticesSize + j * 8 + 6] = mesh->mTextureCoords[0][j].x;
-                meshData.vertices[currentVerticesSize + j * 8 + 7] = mesh->mTextureCoords[0][j].y;
-            } else {
-                meshData.vertices[currentVerticesSize + j * 8 + 6] = 0.0f; meshData.vertices[currentVerticesSize + j * 8 + 7] = 0.0f;
-            }
-        }
+        interleaveVertices(mesh, meshData.vertices.data() + currentVerticesSize);
         unsigned int indexOffset = currentVerticesSize / 8;
         for (unsigned int j = 0; j < mesh->mNumFaces; ++j) {
             const aiFace& face = mesh->mFaces[j];
@@ -374,7 +342,7 @@ void render() {
 void loop(){
     SDL_Event e;
     while(SDL_PollEvent(&e)){
-        if (e.type == SDL_QUIT) emscripten_cancel_main_loop();
+        if (e.type == SDL_QUIT) platformQuit();
         else if(e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_LEFT){
             mouseDown = true; lastX = e.button.x; lastY = e.button.y;
         } else if(e.type == SDL_MOUSEBUTTONUP && e.button.button == SDL_BUTTON_LEFT){
@@ -393,7 +361,7 @@ int main() {
         printf("Initialization failed.\n");
         return 1;
     }
-    emscripten_set_main_loop(loop, 0, 1);
+    platformRun(loop);
     
     harpyModel.cleanup();
     SDL_GL_DeleteContext(glContext);